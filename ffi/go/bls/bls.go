@@ -660,6 +660,9 @@ func (sig *Sign) VerifyAggregateHashes(pubVec []PublicKey, hash [][]byte) bool {
 		return false
 	}
 	hashByte := len(hash[0])
+	if hashByte == 0 {
+		return false
+	}
 	h := make([]byte, n*hashByte)
 	for i := 0; i < n; i++ {
 		hn := len(hash[i])
@@ -81,6 +81,104 @@ typedef struct {
 #endif
 } blsSignature;
 
+/*
+	H(m) ; a message mapped to the group of Signature
+*/
+typedef struct {
+#ifdef BLS_SWAP_G
+	mclBnG2 v;
+#else
+	mclBnG1 v;
+#endif
+} blsMessage;
+
+/*
+	PublicKey in affine coordinates (x, y) for blsPublicKeyRegistry
+*/
+typedef struct {
+#ifdef BLS_SWAP_G
+	mclBnFp x, y;
+#else
+	mclBnFp2 x, y;
+#endif
+} blsPublicKeyAffine;
+
+/*
+	PublicKeys addressed by index
+	keyVec[0, n) is allocated by the caller and set by blsPublicKeyRegistryInit
+*/
+typedef struct {
+	blsPublicKeyAffine *keyVec;
+	mclSize n;
+} blsPublicKeyRegistry;
+
+/*
+	aggregator of PublicKeys selected by a participation bitfield
+	nodeVec[0, 2n) is a segment tree of partial sums and bitVec[0, (n + 7) / 8) is the previous bitfield
+	they are allocated by the caller and set by blsPublicKeyAggregatorInit
+*/
+typedef struct {
+	blsPublicKey *nodeVec;
+	uint8_t *bitVec;
+	blsPublicKey agg;
+	mclSize n;
+	int hasPrev;
+} blsPublicKeyAggregator;
+
+#define BLS_AGG_VERIFY_BUF_N 16
+/*
+	context of streaming aggregate verification
+	it buffers up to BLS_AGG_VERIFY_BUF_N pairs to compute their Miller loops at once
+	and keeps the product of the Miller loops of the flushed pairs,
+	so the size does not depend on the number of pairs
+	the contents are set by blsAggVerifyInit
+*/
+typedef struct {
+	mclBnGT e;
+	blsSignature sig;
+	mclBnG1 g1Vec[BLS_AGG_VERIFY_BUF_N];
+	mclBnG2 g2Vec[BLS_AGG_VERIFY_BUF_N];
+	mclSize n; // the number of the given pairs
+	mclSize bufN; // the number of the buffered pairs
+} blsAggVerifyContext;
+
+/*
+	Lagrange coefficients of a fixed id set for the threshold recovery
+	coeffVec[0, n) is allocated by the caller and set by blsRecoveryPlanInit
+*/
+typedef struct {
+	mclBnFr *coeffVec;
+	mclSize n;
+} blsRecoveryPlan;
+
+// phases of the performance counters
+#define BLS_STATS_HASH_TO_CURVE 0
+#define BLS_STATS_MILLER_LOOP 1
+#define BLS_STATS_FINAL_EXP 2
+#define BLS_STATS_ORDER_CHECK 3
+#define BLS_STATS_DESERIALIZE 4
+#define BLS_STATS_N 5
+/*
+	performance counters summed over all threads
+	callN[i] is the number of calls and ns[i] is the cumulative time in nanoseconds of the phase BLS_STATS_*
+*/
+typedef struct {
+	uint64_t callN[BLS_STATS_N];
+	uint64_t ns[BLS_STATS_N];
+} blsStats;
+
+#ifndef BLS_SWAP_G
+// max number of Fp6 elements of the precomputed coefficients of G2
+#define BLS_MAX_QCOEFF_N 128
+/*
+	precomputed Miller loop coefficients of a PublicKey(G2)
+	the contents are opaque
+*/
+typedef struct {
+	uint64_t v[BLS_MAX_QCOEFF_N * 6 * MCLBN_FP_UNIT_SIZE];
+} blsPublicKeyPrecomputed;
+#endif
+
 /*
 	initialize this library
 	call this once before using the other functions
@@ -145,6 +243,11 @@ BLS_DLL_API int blsFastAggregateVerify(const blsSignature *sig, const blsPublicK
 	@note CHECK that sig has the valid order, all msg are different each other before calling this
 */
 BLS_DLL_API int blsAggregateVerifyNoCheck(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n);
+/*
+	scatter/gather version of blsAggregateVerifyNoCheck
+	msg[i] = msgPtrVec[i][0, msgSizeVec[i]) is hashed in place, so the messages need not be packed into one buffer
+*/
+BLS_DLL_API int blsAggregateVerifyNoCheckPtr(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n);
 
 // return written byte size if success else 0
 BLS_DLL_API mclSize blsIdSerialize(void *buf, mclSize maxBufSize, const blsId *id);
@@ -225,6 +328,23 @@ BLS_DLL_API int blsVerifyHash(const blsSignature *sig, const blsPublicKey *pub,
 	@note do not check duplication of hVec
 */
 BLS_DLL_API int blsVerifyAggregatedHashes(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *hVec, size_t sizeofHash, mclSize n);
+// scatter/gather version of blsVerifyAggregatedHashes ; hVec[i] = hPtrVec[i][0, hSizeVec[i])
+BLS_DLL_API int blsVerifyAggregatedHashesPtr(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *const *hPtrVec, const mclSize *hSizeVec, mclSize n);
+
+#ifndef MCL_DONT_USE_CSPRNG
+/*
+	verify n independent triples (sigVec[i], pubVec[i], msg[i]) at once
+	msgVec is the concatenation of msg[0], ..., msg[n-1]
+	and msg[i] has msgSizeVec[i] bytes
+	check e(P, sum_i r_i sigVec[i]) = prod_i e(r_i pubVec[i], H(msg[i]))
+	for random 64-bit r_i with one final exponentiation
+	return 1 if all triples are valid else 0
+	@note CHECK that all sigVec[i] have the valid order before calling this
+*/
+BLS_DLL_API int blsBatchVerify(const blsSignature *sigVec, const blsPublicKey *pubVec, const void *msgVec, const mclSize *msgSizeVec, mclSize n);
+// scatter/gather version of blsBatchVerify ; msg[i] = msgPtrVec[i][0, msgSizeVec[i])
+BLS_DLL_API int blsBatchVerifyPtr(const blsSignature *sigVec, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n);
+#endif
 
 ///// from here only for BLS12-381 with BLS_ETH
 /*
@@ -253,9 +373,270 @@ BLS_DLL_API mclSize blsSignatureDeserializeUncompressed(blsSignature *sig, const
 	hashWithDomain is an array of size (40 * n)
 */
 BLS_DLL_API int blsVerifyAggregatedHashWithDomain(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char hashWithDomain[][40], mclSize n);
+// hashWithDomainPtrVec[i] points to 40 bytes
+BLS_DLL_API int blsVerifyAggregatedHashWithDomainPtr(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char *const *hashWithDomainPtrVec, mclSize n);
 
 ///// to here only for BLS12-381 with BLS_ETH
 
+#ifndef BLS_SWAP_G
+/*
+	precompute the Miller loop coefficients of pub
+	return 0 if success
+	@note the size of blsPublicKeyPrecomputed is large, so reuse it
+*/
+BLS_DLL_API int blsPublicKeyPrecompute(blsPublicKeyPrecomputed *ppub, const blsPublicKey *pub);
+// same as blsVerify with the precomputed pub
+BLS_DLL_API int blsVerifyPrecomputed(const blsSignature *sig, const blsPublicKeyPrecomputed *ppub, const void *m, mclSize size);
+/*
+	same as blsAggregateVerifyNoCheck with the precomputed ppubVec[0, n)
+	verify e(sig, Q) = prod_i e(H(msg_i), pub_i)
+	@note CHECK that sig has the valid order, all msg are different each other before calling this
+*/
+BLS_DLL_API int blsAggregateVerifyNoCheckPrecomputed(const blsSignature *sig, const blsPublicKeyPrecomputed *ppubVec, const void *msgVec, mclSize msgSize, mclSize n);
+#endif
+
+/*
+	set msg = H(m[0, size)) to skip hash-to-curve in the following verify functions
+	return 0 if success
+	@note blsMessage depends on the setting of blsSetETHmode
+*/
+BLS_DLL_API int blsMessageSet(blsMessage *msg, const void *m, mclSize size);
+BLS_DLL_API void blsSignMessage(blsSignature *sig, const blsSecretKey *sec, const blsMessage *msg);
+BLS_DLL_API int blsVerifyMessage(const blsSignature *sig, const blsPublicKey *pub, const blsMessage *msg);
+BLS_DLL_API int blsFastAggregateVerifyMessage(const blsSignature *sig, const blsPublicKey *pubVec, mclSize n, const blsMessage *msg);
+/*
+	verify e(P, sig) = prod_i e(pubVec[i], msgVec[i]) for i = 0, ..., n - 1
+	@note CHECK that sig has the valid order, all msg are different each other before calling this
+*/
+BLS_DLL_API int blsAggregateVerifyNoCheckMessage(const blsSignature *sig, const blsPublicKey *pubVec, const blsMessage *msgVec, mclSize n);
+
+/*
+	verify e(P, sig) = prod_i e(pubVec[i], H(msg[i])) where some msg[i] may be the same
+	the public keys of the same message are summed, so it computes one hash-to-curve and one Miller loop per distinct message
+	msg[i] = msgVec[i * msgSize, (i + 1) * msgSize) or msgPtrVec[i][0, msgSizeVec[i])
+	@note CHECK that sig has the valid order and every public key has a proof of possession before calling this
+*/
+BLS_DLL_API int blsAggregateVerifyGroupByMessage(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n);
+BLS_DLL_API int blsAggregateVerifyGroupByMessagePtr(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n);
+
+/*
+	streaming version of blsAggregateVerifyNoCheck for messages of any size
+	blsAggVerifyInit(&ctx, sig);
+	blsAggVerifyUpdate(&ctx, pub_i, msg_i, msgSize_i); // for i = 0, ..., n - 1
+	blsAggVerifyFinal(&ctx); // verify e(P, sig) = prod_i e(pub_i, H(msg_i))
+	@note CHECK that sig has the valid order, all msg are different each other before calling this
+*/
+// sig may be NULL for a context which is merged into another one
+BLS_DLL_API void blsAggVerifyInit(blsAggVerifyContext *ctx, const blsSignature *sig);
+BLS_DLL_API void blsAggVerifyUpdate(blsAggVerifyContext *ctx, const blsPublicKey *pub, const void *msg, mclSize msgSize);
+/*
+	add the pairs and the signature of rhs to ctx
+	contexts updated by different threads can be merged into one
+*/
+BLS_DLL_API void blsAggVerifyMerge(blsAggVerifyContext *ctx, const blsAggVerifyContext *rhs);
+// return 1 if valid else 0 (no pair is given)
+BLS_DLL_API int blsAggVerifyFinal(const blsAggVerifyContext *ctx);
+
+/*
+	LRU cache of hash-to-curve keyed by SHA-256 of the message
+	it is used by every function which maps a message to the group of Signature
+	set the max number of entries to maxN (0 disables the cache, default)
+	return 0 if success else -1 (the library is built without thread support)
+	@note the cache is cleared by blsInit and blsSetETHmode
+*/
+BLS_DLL_API int blsSetHashCacheSize(mclSize maxN);
+// get the number of hits and misses since the last blsClearHashCache (each pointer may be NULL)
+BLS_DLL_API void blsGetHashCacheStats(uint64_t *hitN, uint64_t *missN, mclSize *entryN);
+// remove all entries and reset the stats
+BLS_DLL_API void blsClearHashCache(void);
+
+/*
+	SHA-256 implementations used by the library
+	BLS_SHA256_SHA_NI : Intel SHA extensions
+	BLS_SHA256_AVX2 : 8 independent messages at once by AVX2 (e.g. the coefficients of blsMultiAggregateSignature)
+	the portable implementation is used for mode = 0
+	the default is all the implementations which the CPU supports
+*/
+#define BLS_SHA256_SHA_NI 1
+#define BLS_SHA256_AVX2 2
+/*
+	set the implementations to mode (OR of BLS_SHA256_*)
+	return 0 if success else -1 (the CPU does not support it)
+	it may be changed while other threads are hashing ; they use the new mode from the next compression
+	@note call it before using the other functions if BLS_DONT_USE_THREAD is defined or C++11 is not available
+*/
+BLS_DLL_API int blsSetSha256Mode(int mode);
+BLS_DLL_API int blsGetSha256Mode(void);
+// return the implementations which the CPU supports
+BLS_DLL_API int blsGetSha256SupportedMode(void);
+/*
+	md = SHA-256(msg[0, msgSize))
+	return 32 if success else 0 (mdSize < 32)
+*/
+BLS_DLL_API mclSize blsSha256(void *md, mclSize mdSize, const void *msg, mclSize msgSize);
+
+/*
+	performance counters of the hot paths enabled by building the library with BLS_USE_STATS
+	BLS_STATS_HASH_TO_CURVE : hash-to-curve (not counted if the hash cache hits)
+	BLS_STATS_MILLER_LOOP : each call of (multi-)Miller loop
+	BLS_STATS_FINAL_EXP : final exponentiation
+	BLS_STATS_ORDER_CHECK : blsPublicKeyIsValidOrder, blsSignatureIsValidOrder and the registry
+	BLS_STATS_DESERIALIZE : blsPublicKeyDeserialize and blsSignatureDeserialize
+	  including the order check by blsPublicKeyVerifyOrder and blsSignatureVerifyOrder
+	each thread updates its own counters and they are summed on read
+	return 0 if success else -1 (the counters are disabled and stats is cleared)
+*/
+BLS_DLL_API int blsGetStats(blsStats *stats);
+// set all counters to zero
+BLS_DLL_API void blsResetStats(void);
+/*
+	write the counters to buf as the Prometheus text format ('\0' terminated)
+	return strlen(buf) if success else 0 (the counters are disabled or buf is too small)
+*/
+BLS_DLL_API mclSize blsGetStatsText(char *buf, mclSize maxBufSize);
+
+/*
+	set reg->keyVec = keyVec and store pubVec[0, n) in it as affine points
+	return 0 if success else -1 (reg->n = 0)
+	@note each pubVec[i] must have the valid order and must not be zero
+*/
+BLS_DLL_API int blsPublicKeyRegistryInit(blsPublicKeyRegistry *reg, blsPublicKeyAffine *keyVec, const blsPublicKey *pubVec, mclSize n);
+/*
+	the following functions use reg->keyVec[idxVec[i]] as the i-th PublicKey for i = 0, ..., n - 1
+	return 0 (or -1 for blsAggregatePublicKeyIdx) if idxVec[i] >= reg->n for some i
+*/
+BLS_DLL_API int blsAggregatePublicKeyIdx(blsPublicKey *aggPub, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, mclSize n);
+BLS_DLL_API int blsFastAggregateVerifyIdx(const blsSignature *sig, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, mclSize n, const void *msg, mclSize msgSize);
+// @note CHECK that sig has the valid order, all msg are different each other before calling this
+BLS_DLL_API int blsAggregateVerifyNoCheckIdx(const blsSignature *sig, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, const void *msgVec, mclSize msgSize, mclSize n);
+
+/*
+	init ag with pubVec[0, n) and the caller-allocated nodeVec[0, 2n) and bitVec[0, (n + 7) / 8)
+	return 0 if success else -1 (n = 0)
+*/
+BLS_DLL_API int blsPublicKeyAggregatorInit(blsPublicKeyAggregator *ag, blsPublicKey *nodeVec, uint8_t *bitVec, const blsPublicKey *pubVec, mclSize n);
+/*
+	aggPub = sum of pubVec[i] such that bit i of bitfield is one for i = 0, ..., n - 1
+	bit i is (bitfield[i / 8] >> (i % 8)) & 1
+	it sums the participants, subtracts the absentees from the total or updates the previous result
+	by the changed bits whichever is the cheapest and each run of consecutive bits is summed by the segment tree
+	return 0 if success
+	@note ag is updated, so it is not thread-safe
+*/
+BLS_DLL_API int blsPublicKeyAggregatorGet(blsPublicKey *aggPub, blsPublicKeyAggregator *ag, const uint8_t *bitfield);
+
+/*
+	init plan with idVec[0, n) and the caller-allocated coeffVec[0, n)
+	coeffVec[i] is the Lagrange coefficient of idVec[i] at zero computed with one inversion
+	return 0 if success else -1 (n = 0, a zero id or the same ids)
+*/
+BLS_DLL_API int blsRecoveryPlanInit(blsRecoveryPlan *plan, mclBnFr *coeffVec, const blsId *idVec, mclSize n);
+/*
+	recover sec (resp. pub, sig) from secVec[0, n) (resp. pubVec, sigVec) corresponding to idVec of plan
+	the result is the same as blsSecretKeyRecover (resp. blsPublicKeyRecover, blsSignatureRecover)
+	but it computes only the multi-scalar multiplication
+	return 0 if success
+*/
+BLS_DLL_API int blsSecretKeyRecoverByPlan(blsSecretKey *sec, const blsSecretKey *secVec, const blsRecoveryPlan *plan);
+BLS_DLL_API int blsPublicKeyRecoverByPlan(blsPublicKey *pub, const blsPublicKey *pubVec, const blsRecoveryPlan *plan);
+BLS_DLL_API int blsSignatureRecoverByPlan(blsSignature *sig, const blsSignature *sigVec, const blsRecoveryPlan *plan);
+/*
+	multi-thread version of the recovery for large n
+	the denominators of the coefficients are computed on threadN threads and inverted at once
+	and the sum is computed by the bucket method on threadN threads
+	use all cpus if threadN == 0
+	return the same value as blsSecretKeyRecover (resp. blsPublicKeyRecover, blsSignatureRecover)
+*/
+BLS_DLL_API int blsRecoveryPlanInitMT(blsRecoveryPlan *plan, mclBnFr *coeffVec, const blsId *idVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsPublicKeyRecoverByPlanMT(blsPublicKey *pub, const blsPublicKey *pubVec, const blsRecoveryPlan *plan, mclSize threadN);
+BLS_DLL_API int blsSignatureRecoverByPlanMT(blsSignature *sig, const blsSignature *sigVec, const blsRecoveryPlan *plan, mclSize threadN);
+BLS_DLL_API int blsSecretKeyRecoverMT(blsSecretKey *sec, const blsSecretKey *secVec, const blsId *idVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsPublicKeyRecoverMT(blsPublicKey *pub, const blsPublicKey *pubVec, const blsId *idVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsSignatureRecoverMT(blsSignature *sig, const blsSignature *sigVec, const blsId *idVec, mclSize n, mclSize threadN);
+/*
+	make secVec[i] (resp. pubVec[i]) corresponding to idVec[i] from msk[0, k) (resp. mpk[0, k)) for i = 0, ..., n - 1
+	the ids are split into threadN ranges and each pubVec[i] is a multi-scalar multiplication of mpk by the powers of idVec[i]
+	use all cpus if threadN == 0
+	the result is the same as blsSecretKeyShare (resp. blsPublicKeyShare)
+	return 0 if success
+	@note secVec (resp. pubVec) must not overlap msk (resp. mpk)
+*/
+BLS_DLL_API int blsSecretKeyShareVec(blsSecretKey *secVec, const blsSecretKey *msk, mclSize k, const blsId *idVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsPublicKeyShareVec(blsPublicKey *pubVec, const blsPublicKey *mpk, mclSize k, const blsId *idVec, mclSize n, mclSize threadN);
+
+/*
+	multi-thread version of blsAggregateVerifyNoCheck, blsVerifyAggregatedHashes and blsVerifyAggregatedHashWithDomain
+	each thread hashes and computes the Miller loops of a disjoint range
+	and the partial products are multiplied before one final exponentiation
+	@param threadN [in] the number of threads (0 means the number of hardware threads)
+	return the same value as the single thread version
+	@note threadN is ignored if the library is built without thread support
+*/
+BLS_DLL_API int blsAggregateVerifyNoCheckMT(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n, mclSize threadN);
+BLS_DLL_API int blsVerifyAggregatedHashesMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *hVec, size_t sizeofHash, mclSize n, mclSize threadN);
+BLS_DLL_API int blsVerifyAggregatedHashWithDomainMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char hashWithDomain[][40], mclSize n, mclSize threadN);
+// multi-thread version of the scatter/gather versions
+BLS_DLL_API int blsAggregateVerifyNoCheckPtrMT(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsVerifyAggregatedHashesPtrMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *const *hPtrVec, const mclSize *hSizeVec, mclSize n, mclSize threadN);
+BLS_DLL_API int blsVerifyAggregatedHashWithDomainPtrMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char *const *hashWithDomainPtrVec, mclSize n, mclSize threadN);
+
+/*
+	deserialize pubVec[i] (resp. sigVec[i]) from buf[i * stride, (i + 1) * stride) for i = 0, ..., n - 1 on threadN threads
+	okVec[i] = 1 if blsPublicKeyDeserialize (resp. blsSignatureDeserialize) succeeds else 0
+	return the number of successes
+	@note the order is checked as the single version (see blsPublicKeyVerifyOrder and blsSignatureVerifyOrder)
+*/
+BLS_DLL_API mclSize blsPublicKeyDeserializeVec(blsPublicKey *pubVec, int *okVec, const void *buf, mclSize stride, mclSize n, mclSize threadN);
+BLS_DLL_API mclSize blsSignatureDeserializeVec(blsSignature *sigVec, int *okVec, const void *buf, mclSize stride, mclSize n, mclSize threadN);
+
+/*
+	normalize pubVec[0, n) (resp. sigVec[0, n)) with one field inversion per 128 elements
+	the values are not changed but z = 1 for non-zero elements
+*/
+BLS_DLL_API void blsPublicKeyNormalizeVec(blsPublicKey *pubVec, mclSize n);
+BLS_DLL_API void blsSignatureNormalizeVec(blsSignature *sigVec, mclSize n);
+
+/*
+	serialize pubVec[i] (resp. sigVec[i]) to buf[i * stride, (i + 1) * stride) for i = 0, ..., n - 1 on threadN threads
+	the points are normalized by one field inversion per 64 elements
+	the format of each element is the same as blsPublicKeySerialize (resp. blsSignatureSerialize)
+	or the *Uncompressed version and the remaining bytes of each stride are not changed
+	return n * stride if success else 0
+*/
+BLS_DLL_API mclSize blsPublicKeySerializeVec(void *buf, mclSize stride, const blsPublicKey *pubVec, mclSize n, mclSize threadN);
+BLS_DLL_API mclSize blsSignatureSerializeVec(void *buf, mclSize stride, const blsSignature *sigVec, mclSize n, mclSize threadN);
+BLS_DLL_API mclSize blsPublicKeySerializeUncompressedVec(void *buf, mclSize stride, const blsPublicKey *pubVec, mclSize n, mclSize threadN);
+BLS_DLL_API mclSize blsSignatureSerializeUncompressedVec(void *buf, mclSize stride, const blsSignature *sigVec, mclSize n, mclSize threadN);
+
+/*
+	pubVec[i] = the public key of secVec[i] for i = 0, ..., n - 1 on threadN threads
+	the result is the same as blsGetPublicKey
+	@note blsGetPublicKey uses the fixed-base table of the generator made by blsInit in constant time
+*/
+BLS_DLL_API void blsGetPublicKeyVec(blsPublicKey *pubVec, const blsSecretKey *secVec, mclSize n, mclSize threadN);
+/*
+	sigVec[i] = the signature of msgPtrVec[i][0, msgSizeVec[i]) by secVec[i] for i = 0, ..., n - 1 on threadN threads
+	each thread hashes the messages and signs them of a disjoint range
+	use all cpus if threadN == 0
+	the result is the same as blsSign
+*/
+BLS_DLL_API void blsSignVec(blsSignature *sigVec, const blsSecretKey *secVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n, mclSize threadN);
+/*
+	sigVec[i] = the signature of m[0, size) by secVec[i] for i = 0, ..., n - 1
+	the message is hashed to the curve only once
+	the result is the same as blsSign
+*/
+BLS_DLL_API void blsSignSameMessage(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *m, mclSize size);
+/*
+	sigVec[i] = the signature of the hash h[0, size) by secVec[i] for i = 0, ..., n - 1
+	the result is the same as blsSignHash
+	return 0 if success
+*/
+BLS_DLL_API int blsSignHashSameMessage(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *h, mclSize size);
+// multi-thread versions (use all cpus if threadN == 0)
+BLS_DLL_API void blsSignSameMessageMT(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *m, mclSize size, mclSize threadN);
+BLS_DLL_API int blsSignHashSameMessageMT(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *h, mclSize size, mclSize threadN);
+
 // sub
 BLS_DLL_API void blsSecretKeySub(blsSecretKey *sec, const blsSecretKey *rhs);
 BLS_DLL_API void blsPublicKeySub(blsPublicKey *pub, const blsPublicKey *rhs);
@@ -366,6 +747,13 @@ BLS_DLL_API void blsDHKeyExchange(blsPublicKey *out, const blsSecretKey *sec, co
 BLS_DLL_API void blsMultiAggregateSignature(blsSignature *aggSig, blsSignature *sigVec, blsPublicKey *pubVec, mclSize n);
 // aggPub = sum pubVec[i] t_i where (t_1, ..., t_n) = H({pubVec})
 BLS_DLL_API void blsMultiAggregatePublicKey(blsPublicKey *aggPub, blsPublicKey *pubVec, mclSize n);
+/*
+	multi-thread version of blsMultiAggregateSignature and blsMultiAggregatePublicKey
+	the result is the same as the single-thread version
+	use all cpus if threadN == 0
+*/
+BLS_DLL_API void blsMultiAggregateSignatureMT(blsSignature *aggSig, blsSignature *sigVec, blsPublicKey *pubVec, mclSize n, mclSize threadN);
+BLS_DLL_API void blsMultiAggregatePublicKeyMT(blsPublicKey *aggPub, blsPublicKey *pubVec, mclSize n, mclSize threadN);
 #endif // BLS_MINIMUM_API
 
 #ifdef __cplusplus
@@ -158,6 +158,38 @@ public:
 	}
 };
 
+/*
+	Lagrange coefficients of a fixed id set
+	recover(vec, plan) is faster than recover(vec, idVec) for the same idVec
+*/
+class RecoveryPlan {
+	std::vector<mclBnFr> coeffVec_;
+public:
+	RecoveryPlan() {}
+	explicit RecoveryPlan(const IdVec& idVec) { set(idVec); }
+	void set(const IdVec& idVec)
+	{
+		set(idVec.data(), idVec.size());
+	}
+	size_t size() const { return coeffVec_.size(); }
+	blsRecoveryPlan get() const
+	{
+		blsRecoveryPlan plan;
+		plan.coeffVec = const_cast<mclBnFr*>(coeffVec_.data());
+		plan.n = coeffVec_.size();
+		return plan;
+	}
+	// the following methods are for C api
+	void set(const Id *idVec, size_t n)
+	{
+		std::vector<mclBnFr> coeffVec(n);
+		blsRecoveryPlan plan;
+		int ret = blsRecoveryPlanInit(&plan, coeffVec.data(), idVec->getPtr(), n);
+		if (ret != 0) throw std::runtime_error("blsRecoveryPlanInit:same id");
+		coeffVec_.swap(coeffVec);
+	}
+};
+
 /*
 	s ; secret key
 */
@@ -280,6 +312,15 @@ public:
 		if (secVec.size() != idVec.size()) throw std::invalid_argument("SecretKey:recover");
 		recover(secVec.data(), idVec.data(), idVec.size());
 	}
+	/*
+		recover secretKey from secVec corresponding to the ids of plan
+	*/
+	void recover(const SecretKeyVec& secVec, const RecoveryPlan& plan)
+	{
+		if (plan.size() == 0 || secVec.size() != plan.size()) throw std::invalid_argument("SecretKey:recover");
+		const blsRecoveryPlan p = plan.get();
+		blsSecretKeyRecoverByPlan(&self_, &secVec[0].self_, &p);
+	}
 	/*
 		add secret key
 	*/
@@ -299,6 +340,10 @@ public:
 		int ret = blsSecretKeyRecover(&self_, &secVec->self_, &idVec->self_, n);
 		if (ret != 0) throw std::runtime_error("blsSecretKeyRecover:same id");
 	}
+	/*
+		pubVec[i] = the public key of secVec[i] for i = 0, ..., n - 1 on threadN threads
+	*/
+	static void getPublicKeyVec(PublicKey *pubVec, const SecretKey *secVec, size_t n, size_t threadN = 1);
 };
 
 /*
@@ -389,6 +434,15 @@ public:
 		if (pubVec.size() != idVec.size()) throw std::invalid_argument("PublicKey:recover");
 		recover(pubVec.data(), idVec.data(), idVec.size());
 	}
+	/*
+		recover publicKey from pubVec corresponding to the ids of plan
+	*/
+	void recover(const PublicKeyVec& pubVec, const RecoveryPlan& plan)
+	{
+		if (plan.size() == 0 || pubVec.size() != plan.size()) throw std::invalid_argument("PublicKey:recover");
+		const blsRecoveryPlan p = plan.get();
+		blsPublicKeyRecoverByPlan(&self_, &pubVec[0].self_, &p);
+	}
 	/*
 		add public key
 	*/
@@ -519,6 +573,15 @@ public:
 		if (sigVec.size() != idVec.size()) throw std::invalid_argument("Signature:recover");
 		recover(sigVec.data(), idVec.data(), idVec.size());
 	}
+	/*
+		recover sig from sigVec corresponding to the ids of plan
+	*/
+	void recover(const SignatureVec& sigVec, const RecoveryPlan& plan)
+	{
+		if (plan.size() == 0 || sigVec.size() != plan.size()) throw std::invalid_argument("Signature:recover");
+		const blsRecoveryPlan p = plan.get();
+		blsSignatureRecoverByPlan(&self_, &sigVec[0].self_, &p);
+	}
 	/*
 		add signature
 	*/
@@ -542,15 +605,18 @@ inline void getMasterPublicKey(PublicKeyVec& mpk, const SecretKeyVec& msk)
 {
 	const size_t n = msk.size();
 	mpk.resize(n);
-	for (size_t i = 0; i < n; i++) {
-		msk[i].getPublicKey(mpk[i]);
-	}
+	if (n == 0) return;
+	SecretKey::getPublicKeyVec(&mpk[0], &msk[0], n);
 }
 
 inline void SecretKey::getPublicKey(PublicKey& pub) const
 {
 	blsGetPublicKey(&pub.self_, &self_);
 }
+inline void SecretKey::getPublicKeyVec(PublicKey *pubVec, const SecretKey *secVec, size_t n, size_t threadN)
+{
+	blsGetPublicKeyVec(&pubVec->self_, &secVec->self_, n, threadN);
+}
 inline void SecretKey::sign(Signature& sig, const void *m, size_t size) const
 {
 	blsSign(&sig.self_, &self_, m, size);
@@ -0,0 +1,223 @@
+#pragma once
+/**
+	@file
+	@brief asynchronous batch verification service
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+	@note requires C++11 and blsBatchVerify (MCL_DONT_USE_CSPRNG must not be defined)
+*/
+#include <bls/bls.hpp>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+
+namespace bls {
+
+/*
+	verify (sig, pub, msg) jobs submitted from many threads in batches
+	- submit() pushes a job to a lock-free queue and never blocks on the worker
+	- the worker cuts a batch if maxBatchSize jobs are queued or maxLatencyUsec has passed since it saw the first one
+	- a job whose signature does not have the valid order is 0 without being batched, since blsBatchVerify requires it
+	- a batch is verified by blsBatchVerify (one final exponentiation)
+	- if the batch fails then each job is verified by blsVerify, so an invalid job does not affect the others
+	- the result is 1 (valid) or 0 (invalid) and is given by the callback and the returned Result
+	@note the callback is called in the worker thread, so it must not block for long
+*/
+class VerifyService {
+public:
+	typedef void (*Callback)(void *arg, int result);
+private:
+	// result of a job shared by the worker and Result ; v is -1 until the job is verified
+	struct State {
+		std::atomic<int> v;
+		std::mutex m;
+		std::condition_variable cv;
+		State() : v(-1) {}
+		void set(int result)
+		{
+			std::lock_guard<std::mutex> lk(m);
+			v.store(result, std::memory_order_release);
+			cv.notify_all();
+		}
+	};
+public:
+	/*
+		pollable result of a submitted job
+	*/
+	class Result {
+		friend class VerifyService;
+		std::shared_ptr<State> st_;
+		explicit Result(const std::shared_ptr<State>& st) : st_(st) {}
+	public:
+		Result() {}
+		bool isReady() const { return st_ && st_->v.load(std::memory_order_acquire) >= 0; }
+		// return -1 if not ready else 0 or 1
+		int get() const { return st_ ? st_->v.load(std::memory_order_acquire) : -1; }
+		// block until ready and return the result
+		int wait() const
+		{
+			if (!st_) return -1;
+			std::unique_lock<std::mutex> lk(st_->m);
+			while (st_->v.load(std::memory_order_acquire) < 0) st_->cv.wait(lk);
+			return st_->v.load(std::memory_order_acquire);
+		}
+	};
+private:
+	struct Job {
+		blsSignature sig;
+		blsPublicKey pub;
+		std::string msg;
+		Callback f;
+		void *arg;
+		std::shared_ptr<State> result;
+		Job *next;
+	};
+	std::atomic<Job*> head_; // lock-free stack of submitted jobs
+	std::atomic<size_t> pending_;
+	const size_t maxBatchSize_;
+	const std::chrono::microseconds maxLatency_;
+	bool stop_;
+	std::mutex m_; // only to sleep and wake the worker
+	std::condition_variable cv_;
+	std::thread worker_;
+	VerifyService(const VerifyService&);
+	void operator=(const VerifyService&);
+
+	void wake()
+	{
+		std::lock_guard<std::mutex> lk(m_);
+		cv_.notify_one();
+	}
+	static void finish(Job *job, int result)
+	{
+		job->result->set(result);
+		if (job->f) job->f(job->arg, result);
+	}
+	void verifyBatch(Job **allJobVec, size_t allN)
+	{
+		std::vector<Job*> jobVec;
+		jobVec.reserve(allN);
+		for (size_t i = 0; i < allN; i++) {
+			if (blsSignatureIsValidOrder(&allJobVec[i]->sig)) {
+				jobVec.push_back(allJobVec[i]);
+			} else {
+				finish(allJobVec[i], 0);
+			}
+		}
+		const size_t n = jobVec.size();
+		if (n == 0) return;
+		std::vector<blsSignature> sigVec(n);
+		std::vector<blsPublicKey> pubVec(n);
+		std::vector<const void*> msgPtrVec(n);
+		std::vector<mclSize> msgSizeVec(n);
+		for (size_t i = 0; i < n; i++) {
+			sigVec[i] = jobVec[i]->sig;
+			pubVec[i] = jobVec[i]->pub;
+			msgPtrVec[i] = jobVec[i]->msg.data();
+			msgSizeVec[i] = jobVec[i]->msg.size();
+		}
+		if (blsBatchVerifyPtr(sigVec.data(), pubVec.data(), msgPtrVec.data(), msgSizeVec.data(), n) == 1) {
+			for (size_t i = 0; i < n; i++) finish(jobVec[i], 1);
+			return;
+		}
+		for (size_t i = 0; i < n; i++) {
+			Job *job = jobVec[i];
+			finish(job, blsVerify(&job->sig, &job->pub, job->msg.data(), job->msg.size()));
+		}
+	}
+	// verify all queued jobs in the submitted order
+	void process()
+	{
+		Job *list = head_.exchange(0, std::memory_order_acquire);
+		std::vector<Job*> jobVec;
+		while (list) {
+			jobVec.push_back(list);
+			list = list->next;
+		}
+		const size_t n = jobVec.size();
+		if (n == 0) return;
+		pending_.fetch_sub(n);
+		std::reverse(jobVec.begin(), jobVec.end());
+		for (size_t pos = 0; pos < n; pos += maxBatchSize_) {
+			verifyBatch(&jobVec[pos], std::min(maxBatchSize_, n - pos));
+		}
+		for (size_t i = 0; i < n; i++) delete jobVec[i];
+	}
+	void run()
+	{
+		for (;;) {
+			std::unique_lock<std::mutex> lk(m_);
+			while (!stop_ && pending_.load() == 0) cv_.wait(lk);
+			if (stop_ && pending_.load() == 0) return;
+			const std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + maxLatency_;
+			while (!stop_ && pending_.load() < maxBatchSize_) {
+				if (cv_.wait_until(lk, deadline) == std::cv_status::timeout) break;
+			}
+			lk.unlock();
+			process();
+		}
+	}
+public:
+	/*
+		@param maxBatchSize [in] verify at most maxBatchSize jobs at once
+		@param maxLatencyUsec [in] max waiting time in microseconds before verifying a batch
+	*/
+	explicit VerifyService(size_t maxBatchSize = 64, size_t maxLatencyUsec = 1000)
+		: head_(0)
+		, pending_(0)
+		, maxBatchSize_(maxBatchSize == 0 ? 1 : maxBatchSize)
+		, maxLatency_(maxLatencyUsec)
+		, stop_(false)
+	{
+		worker_ = std::thread(&VerifyService::run, this);
+	}
+	/*
+		verify the remaining jobs and stop the worker
+	*/
+	~VerifyService()
+	{
+		{
+			std::lock_guard<std::mutex> lk(m_);
+			stop_ = true;
+			cv_.notify_one();
+		}
+		worker_.join();
+		process();
+	}
+	/*
+		submit a job to verify sig of msg[0, msgSize) by pub
+		msg is copied, so the caller may release it after return
+		f(arg, result) is called when the job is verified if f is not null
+	*/
+	Result submit(const blsSignature& sig, const blsPublicKey& pub, const void *msg, size_t msgSize, Callback f = 0, void *arg = 0)
+	{
+		Job *job = new Job();
+		job->sig = sig;
+		job->pub = pub;
+		job->msg.assign((const char*)msg, msgSize);
+		job->f = f;
+		job->arg = arg;
+		job->result = std::make_shared<State>();
+		Result ret(job->result);
+		// count it before pushing so that pending_ is never less than the number of queued jobs
+		const size_t n = pending_.fetch_add(1) + 1;
+		job->next = head_.load(std::memory_order_relaxed);
+		while (!head_.compare_exchange_weak(job->next, job, std::memory_order_release, std::memory_order_relaxed)) {
+		}
+		// start the latency timer for the first job and cut a batch if it is full
+		if (n == 1 || n == maxBatchSize_) wake();
+		return ret;
+	}
+	Result submit(const Signature& sig, const PublicKey& pub, const void *msg, size_t msgSize, Callback f = 0, void *arg = 0)
+	{
+		return submit(*sig.getPtr(), *pub.getPtr(), msg, msgSize, f, arg);
+	}
+	// the number of jobs which are not yet verified
+	size_t getPendingNum() const { return pending_.load(); }
+};
+
+} // bls
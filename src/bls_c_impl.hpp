@@ -34,13 +34,91 @@ inline const Fp12 *cast(const mclBnGT *p) { return reinterpret_cast<const Fp12*>
 inline Fp6 *cast(uint64_t *p) { return reinterpret_cast<Fp6*>(p); }
 inline const Fp6 *cast(const uint64_t *p) { return reinterpret_cast<const Fp6*>(p); }
 #endif
+#include "sha256.hpp"
+#include "stats.hpp"
 
 inline void Gmul(G1& z, const G1& x, const Fr& y) { G1::mul(z, x, y); }
 inline void Gmul(G2& z, const G2& x, const Fr& y) { G2::mul(z, x, y); }
 inline void GmulCT(G1& z, const G1& x, const Fr& y) { G1::mulCT(z, x, y); }
 inline void GmulCT(G2& z, const G2& x, const Fr& y) { G2::mulCT(z, x, y); }
-inline void hashAndMapToG(G1& z, const void *m, mclSize size) { hashAndMapToG1(z, m, size); }
-inline void hashAndMapToG(G2& z, const void *m, mclSize size) { hashAndMapToG2(z, m, size); }
+inline void hashAndMapToG(G1& z, const void *m, mclSize size) { BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, hashAndMapToG1(z, m, size)); }
+inline void hashAndMapToG(G2& z, const void *m, mclSize size) { BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, hashAndMapToG2(z, m, size)); }
+
+/*
+	*MT apis run on multiple threads if BLS_USE_THREAD is defined
+	define BLS_DONT_USE_THREAD to disable it
+*/
+#if !defined(BLS_DONT_USE_THREAD) && !defined(BLS_MINIMUM_API) && !defined(__EMSCRIPTEN__) && !defined(__wasm__) && !defined(CYBOZU_DONT_USE_STRING) \
+	&& (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+	#define BLS_USE_THREAD
+	#include <thread>
+	#include <functional>
+#endif
+
+#ifndef BLS_MINIMUM_API
+#include <vector>
+#include <new>
+/*
+	v.resize(n) and return false if it fails to allocate memory
+	the temporary buffers of the vector apis are allocated by this
+*/
+template<class T>
+bool resizeVec(std::vector<T>& v, size_t n)
+{
+#ifdef CYBOZU_DONT_USE_EXCEPTION
+	v.resize(n);
+	return true;
+#else
+	try {
+		v.resize(n);
+		return true;
+	} catch (std::bad_alloc&) {
+		return false;
+	}
+#endif
+}
+#endif
+
+#ifdef BLS_USE_THREAD
+/*
+	return the number of threads to process n elements
+	threadN = 0 means the number of hardware threads
+*/
+inline size_t getThreadN(size_t threadN, size_t n)
+{
+	if (threadN == 0) {
+		threadN = std::thread::hardware_concurrency();
+		if (threadN == 0) threadN = 1;
+	}
+	if (threadN > n) threadN = n;
+	return threadN;
+}
+
+/*
+	split [0, n) into threadN ranges and call f(begin, end, idx) for the idx-th range
+	the last range is processed by the caller thread
+	@note 0 < threadN <= n
+*/
+template<class F>
+void parallelFor(F& f, size_t n, size_t threadN)
+{
+	std::vector<std::thread> ths;
+	ths.reserve(threadN - 1);
+	size_t begin = 0;
+	for (size_t i = 0; i < threadN; i++) {
+		size_t end = begin + n / threadN + (i < n % threadN ? 1 : 0);
+		if (i == threadN - 1) {
+			f(begin, end, i);
+		} else {
+			ths.push_back(std::thread(std::ref(f), begin, end, i));
+		}
+		begin = end;
+	}
+	for (size_t i = 0; i < ths.size(); i++) {
+		ths[i].join();
+	}
+}
+#endif
 
 /*
 	BLS signature
@@ -83,13 +161,304 @@ inline const G1& getBasePointAdjInv() { return g_PadjInv[g_adjInvIdx]; } // for
 typedef G1 G;
 typedef G2 Gother;
 static G2 g_Q;
-const size_t maxQcoeffN = 128;
+const size_t maxQcoeffN = BLS_MAX_QCOEFF_N;
 static mcl::FixedArray<Fp6, maxQcoeffN> g_Qcoeff; // precomputed Q
 inline const G2& getBasePoint() { return g_Q; }
 inline const G2& getBasePointAdjInv() { return getBasePoint(); } // same
 inline const mcl::FixedArray<Fp6, maxQcoeffN>& getQcoeff() { return g_Qcoeff; }
 #endif
 
+#ifndef BLS_MINIMUM_API
+/*
+	normalize xVec[0, n) by Montgomery's trick
+	1/z_i = (z_0 ... z_{i-1}) / (z_0 ... z_i)
+	one inversion per N points without heap
+	skip zero and the points with z = 1
+*/
+template<class E>
+void normalizeVec(E *xVec, size_t n)
+{
+	typedef typename E::Fp F;
+	const size_t N = 128;
+	F tbl[N]; // tbl[i] = product of z of the target points before xVec[pos + i]
+	size_t pos = 0;
+	while (pos < n) {
+		size_t m = n - pos;
+		if (m > N) m = N;
+		E *x = &xVec[pos];
+		F acc = 1;
+		bool found = false;
+		for (size_t i = 0; i < m; i++) {
+			if (x[i].z.isZero() || x[i].z.isOne()) continue;
+			tbl[i] = acc;
+			acc *= x[i].z;
+			found = true;
+		}
+		if (found) {
+			F::inv(acc, acc); // 1 / (product of all z)
+			for (size_t i = m; i > 0;) {
+				i--;
+				if (x[i].z.isZero() || x[i].z.isOne()) continue;
+				F zInv = acc * tbl[i];
+				acc *= x[i].z;
+				if (E::mode_ == mcl::ec::Jacobi) {
+					F zInv2;
+					F::sqr(zInv2, zInv);
+					x[i].x *= zInv2;
+					x[i].y *= zInv2 * zInv;
+				} else {
+					x[i].x *= zInv;
+					x[i].y *= zInv;
+				}
+				x[i].z = 1;
+			}
+		}
+		pos += m;
+	}
+}
+
+/*
+	return the c-bit value at bit position pos of x[0, xn) (little endian)
+	@note 0 < c < the bit size of Unit
+*/
+inline size_t getWindow(const mcl::fp::Unit *x, size_t xn, size_t pos, size_t c)
+{
+	const size_t unitBit = sizeof(mcl::fp::Unit) * 8;
+	const size_t q = pos / unitBit;
+	const size_t r = pos % unitBit;
+	if (q >= xn) return 0;
+	mcl::fp::Unit v = x[q] >> r;
+	if (r + c > unitBit && q + 1 < xn) v |= x[q + 1] << (unitBit - r);
+	return size_t(v & ((mcl::fp::Unit(1) << c) - 1));
+}
+
+// y[0, yn) = x as little endian
+inline void getUnit(mcl::fp::Unit *y, size_t yn, const Fr& x)
+{
+	mcl::fp::Block b;
+	x.getBlock(b);
+	for (size_t i = 0; i < yn; i++) {
+		y[i] = i < b.n ? b.p[i] : 0;
+	}
+}
+
+/*
+	fixed-base table of the generator of PublicKey
+	g_baseTbl[w * baseD + j] = (2j + 1) 2^(w baseC) getBasePoint() for j = 0, ..., baseD - 1
+	an odd scalar is recoded to odd signed baseC-bit digits in [-2^baseC + 1, 2^baseC - 1]
+	so that the multiplication costs only g_baseWinN - 1 mixed additions
+*/
+const size_t baseC = 4;
+const size_t baseD = size_t(1) << (baseC - 1);
+const size_t maxBaseWinN = (MCLBN_FR_UNIT_SIZE * 64 + baseC - 1) / baseC;
+static Gother g_baseTbl[maxBaseWinN * baseD];
+static size_t g_baseWinN;
+
+inline size_t getBaseWinN()
+{
+	return (Fr::getBitSize() + baseC - 1) / baseC;
+}
+
+void initBaseTbl(const Gother& P)
+{
+	const size_t winN = getBaseWinN();
+	Gother Q = P; // 2^(w baseC) P
+	for (size_t w = 0; w < winN; w++) {
+		Gother *tbl = &g_baseTbl[w * baseD];
+		Gother Q2;
+		Gother::dbl(Q2, Q);
+		tbl[0] = Q;
+		for (size_t j = 1; j < baseD; j++) {
+			Gother::add(tbl[j], tbl[j - 1], Q2);
+		}
+		Gother::add(Q, tbl[baseD - 1], Q);
+	}
+	normalizeVec(g_baseTbl, winN * baseD);
+	g_baseWinN = winN;
+}
+
+// z = b ? x : z for b = 0 or 1 without branches
+template<class T>
+void cselect(T& z, const T& x, mcl::fp::Unit b)
+{
+	const mcl::fp::Unit mask = mcl::fp::Unit(0) - b;
+	mcl::fp::Unit *pz = reinterpret_cast<mcl::fp::Unit*>(&z);
+	const mcl::fp::Unit *px = reinterpret_cast<const mcl::fp::Unit*>(&x);
+	for (size_t i = 0; i < sizeof(T) / sizeof(mcl::fp::Unit); i++) {
+		pz[i] ^= (pz[i] ^ px[i]) & mask;
+	}
+}
+
+// return 1 if x == 0 else 0
+inline mcl::fp::Unit isZeroUnit(mcl::fp::Unit x)
+{
+	return ((x | (mcl::fp::Unit(0) - x)) >> (sizeof(mcl::fp::Unit) * 8 - 1)) ^ 1;
+}
+
+/*
+	z = getBasePoint() y by g_baseTbl in constant time
+	k = y (y is odd) or r - y (y is even) is recoded to odd digits d_i
+	k = sum_i d_i 2^(i baseC) where d_i = (((k >> (i baseC)) | 1) mod 2^(baseC + 1)) - 2^baseC for i < winN - 1
+	and d_{winN - 1} = (k >> ((winN - 1) baseC)) | 1
+	all the entries of each window are read and the sign of each digit and k are applied by cselect
+*/
+void mulBase(Gother& z, const Fr& y)
+{
+	const size_t yn = sizeof(Fr) / sizeof(mcl::fp::Unit);
+	const size_t winN = g_baseWinN;
+	mcl::fp::Unit v[yn], nv[yn];
+	getUnit(v, yn, y);
+	Fr ny;
+	Fr::neg(ny, y);
+	getUnit(nv, yn, ny);
+	const mcl::fp::Unit even = (v[0] & 1) ^ 1;
+	mcl::fp::Unit zero = 0;
+	for (size_t i = 0; i < yn; i++) {
+		zero |= v[i];
+		v[i] ^= (v[i] ^ nv[i]) & (mcl::fp::Unit(0) - even);
+	}
+	zero = isZeroUnit(zero);
+	const size_t half = size_t(1) << baseC;
+	for (size_t w = 0; w < winN; w++) {
+		// u = d_w + 2^baseC
+		size_t u;
+		if (w < winN - 1) {
+			u = getWindow(v, yn, w * baseC, baseC + 1) | 1;
+		} else {
+			u = (getWindow(v, yn, w * baseC, baseC) | 1) + half;
+		}
+		const mcl::fp::Unit neg = mcl::fp::Unit((u >> baseC) ^ 1);
+		const size_t mask = size_t(0) - size_t(neg);
+		const size_t a = u - half;
+		const size_t j = (((a ^ mask) - mask) - 1) >> 1; // |d| = 2j + 1
+		const Gother *tbl = &g_baseTbl[w * baseD];
+		Gother T = tbl[0];
+		for (size_t i = 1; i < baseD; i++) {
+			cselect(T, tbl[i], isZeroUnit(mcl::fp::Unit(i ^ j)));
+		}
+		Gother N;
+		Gother::neg(N, T);
+		cselect(T, N, neg);
+		if (w == 0) {
+			z = T;
+		} else {
+			z += T;
+		}
+	}
+	Gother N;
+	Gother::neg(N, z);
+	cselect(z, N, even);
+	N.clear();
+	cselect(z, N, zero);
+}
+#endif
+
+#ifdef BLS_USE_THREAD
+	#define BLS_USE_HASH_CACHE
+	#include <mutex>
+	#include <list>
+	#include <unordered_map>
+	#include <string>
+	#include <atomic>
+#endif
+
+#ifdef BLS_USE_HASH_CACHE
+/*
+	thread-safe LRU cache of hashAndMapToG keyed by SHA-256 of the message
+	hashAndMapToG runs out of the lock, so two threads may compute the same entry at once
+*/
+class HashCache {
+	struct Entry {
+		std::string key;
+		G P;
+	};
+	typedef std::list<Entry> List;
+	typedef std::unordered_map<std::string, List::iterator> Map;
+	std::mutex m_;
+	List list_; // the most recently used entry is at the front
+	Map map_;
+	std::atomic<size_t> maxN_;
+	uint64_t hitN_;
+	uint64_t missN_;
+	void shrink(size_t maxN)
+	{
+		while (list_.size() > maxN) {
+			map_.erase(list_.back().key);
+			list_.pop_back();
+		}
+	}
+public:
+	HashCache() : maxN_(0), hitN_(0), missN_(0) {}
+	bool isEnabled() const { return maxN_.load(std::memory_order_relaxed) > 0; }
+	void setSize(size_t maxN)
+	{
+		std::lock_guard<std::mutex> lk(m_);
+		maxN_ = maxN;
+		shrink(maxN);
+	}
+	void clear(bool resetStats)
+	{
+		std::lock_guard<std::mutex> lk(m_);
+		list_.clear();
+		map_.clear();
+		if (resetStats) {
+			hitN_ = 0;
+			missN_ = 0;
+		}
+	}
+	void getStats(uint64_t *hitN, uint64_t *missN, mclSize *entryN)
+	{
+		std::lock_guard<std::mutex> lk(m_);
+		if (hitN) *hitN = hitN_;
+		if (missN) *missN = missN_;
+		if (entryN) *entryN = list_.size();
+	}
+	void hashAndMapTo(G& P, const void *m, mclSize size)
+	{
+		char md[32];
+		bls::sha256::sha256(md, sizeof(md), m, size);
+		const std::string key(md, sizeof(md));
+		{
+			std::lock_guard<std::mutex> lk(m_);
+			Map::iterator i = map_.find(key);
+			if (i != map_.end()) {
+				list_.splice(list_.begin(), list_, i->second);
+				P = i->second->P;
+				hitN_++;
+				return;
+			}
+			missN_++;
+		}
+		hashAndMapToG(P, m, size);
+		std::lock_guard<std::mutex> lk(m_);
+		const size_t maxN = maxN_;
+		if (maxN == 0 || map_.find(key) != map_.end()) return;
+		Entry e;
+		e.key = key;
+		e.P = P;
+		list_.push_front(e);
+		map_[key] = list_.begin();
+		shrink(maxN);
+	}
+};
+
+static HashCache g_hashCache;
+#endif
+
+/*
+	hashAndMapToG with the cache if it is enabled
+*/
+inline void hashAndMapToGwithCache(G& P, const void *m, mclSize size)
+{
+#ifdef BLS_USE_HASH_CACHE
+	if (g_hashCache.isEnabled()) {
+		g_hashCache.hashAndMapTo(P, m, size);
+		return;
+	}
+#endif
+	hashAndMapToG(P, m, size);
+}
+
 int blsSetETHmode(int mode)
 {
 #ifdef BLS_ETH
@@ -118,6 +487,9 @@ int blsSetETHmode(int mode)
 	default:
 		return -1;
 	}
+#ifdef BLS_USE_HASH_CACHE
+	g_hashCache.clear(false);
+#endif
 	return 0;
 #else
 	(void)mode;
@@ -125,6 +497,102 @@ int blsSetETHmode(int mode)
 #endif
 }
 
+/*
+	tables for blsInit generated at build time by gen_init_tbl
+	tbl has the Montgomery representation of each Fp as fpN units in the order of
+	getBasePoint() (affine), getBasePointAdjInv() (BLS_SWAP_G) or g_Qcoeff (otherwise), g_baseTbl
+*/
+#if defined(BLS_ETH)
+	#define BLS_INIT_TBL_BUILD_MODE 2
+#elif defined(BLS_SWAP_G)
+	#define BLS_INIT_TBL_BUILD_MODE 1
+#else
+	#define BLS_INIT_TBL_BUILD_MODE 0
+#endif
+
+#if MCL_SIZEOF_UNIT == 8
+struct InitTbl {
+	int curve;
+	size_t fpN; // units of Fp
+	size_t qcoeffN; // size of g_Qcoeff (0 if BLS_SWAP_G)
+	size_t baseWinN; // windows of g_baseTbl
+	const uint64_t *tbl;
+};
+
+inline Fp *getFp0(Fp& x) { return &x; }
+inline Fp *getFp0(Fp2& x) { return x.getFp0(); }
+inline const Fp *getFp0(const Fp& x) { return &x; }
+inline const Fp *getFp0(const Fp2& x) { return x.getFp0(); }
+const size_t otherFpN = sizeof(Gother::Fp) / sizeof(Fp); // Fp in a coordinate of Gother
+
+// x[0, n) = p[0, n * fpN) and advance p
+inline void loadFp(Fp *x, size_t n, const uint64_t*& p, size_t fpN)
+{
+	const size_t N = sizeof(Fp) / sizeof(mcl::fp::Unit);
+	for (size_t i = 0; i < n; i++) {
+		mcl::fp::Unit *q = const_cast<mcl::fp::Unit*>(x[i].getUnit());
+		for (size_t j = 0; j < N; j++) {
+			q[j] = j < fpN ? *p++ : 0;
+		}
+	}
+}
+
+inline void loadPoint(Gother& P, const uint64_t*& p, size_t fpN)
+{
+	loadFp(getFp0(P.x), otherFpN, p, fpN);
+	loadFp(getFp0(P.y), otherFpN, p, fpN);
+	P.z = 1;
+}
+
+#ifdef BLS_USE_INIT_TBL
+#include "bls_init_tbl.hpp"
+#if BLS_INIT_TBL_MODE != BLS_INIT_TBL_BUILD_MODE
+	#error "bls_init_tbl.hpp is generated for another BLS_SWAP_G or BLS_ETH. remove it and rebuild"
+#endif
+
+/*
+	set the base point and the precomputed tables of curve by initTblVec
+	return false if there is no table for curve or it does not match mcl in use
+*/
+bool loadInitTbl(int curve)
+{
+	if (mclBn_getVersion() != initTblMclVersion) return false;
+	const size_t fpN = Fp::getUnitSize();
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(initTblVec); i++) {
+		const InitTbl& t = initTblVec[i];
+		if (t.curve != curve) continue;
+		if (t.fpN != fpN) return false;
+#ifndef BLS_SWAP_G
+		if (t.qcoeffN != BN::param.precomputedQcoeffSize || t.qcoeffN > maxQcoeffN) return false;
+#endif
+#ifndef BLS_MINIMUM_API
+		if (t.baseWinN != getBaseWinN()) return false;
+#endif
+		const uint64_t *p = t.tbl;
+#ifdef BLS_SWAP_G
+		loadPoint(g_P, p, fpN);
+		g_PadjInv[0] = g_P;
+		loadPoint(g_PadjInv[1], p, fpN);
+#else
+		loadPoint(g_Q, p, fpN);
+		g_Qcoeff.resize(t.qcoeffN);
+		for (size_t j = 0; j < t.qcoeffN; j++) {
+			loadFp(g_Qcoeff[j].getFp0(), 6, p, fpN);
+		}
+#endif
+#ifndef BLS_MINIMUM_API
+		for (size_t j = 0; j < t.baseWinN * baseD; j++) {
+			loadPoint(g_baseTbl[j], p, fpN);
+		}
+		g_baseWinN = t.baseWinN;
+#endif
+		return true;
+	}
+	return false;
+}
+#endif
+#endif
+
 int blsInit(int curve, int compiledTimeVar)
 {
 	if (compiledTimeVar != MCLBN_COMPILED_TIME_VAR) {
@@ -138,58 +606,76 @@ int blsInit(int curve, int compiledTimeVar)
 #endif
 	if (!b) return -1;
 	g_curveType = curve;
+#if defined(BLS_USE_INIT_TBL) && MCL_SIZEOF_UNIT == 8
+	const bool useInitTbl = loadInitTbl(curve);
+#else
+	const bool useInitTbl = false;
+#endif
 
 #ifdef BLS_SWAP_G
 	#ifdef BLS_ETH
 	g_newEth2 = false;
 	if (curve == MCL_BLS12_381) {
 		mclBn_setETHserialization(1);
-		g_P.setStr(&b, "1 3685416753713387016781088315183077757961620795782546409894578378688607592378376318836054947676345821548104185464507 1339506544944476473020471379941921221584933875938349620426543736416511423956333506472724655353366534992391756441569", 10);
+		if (!useInitTbl) {
+			g_P.setStr(&b, "1 3685416753713387016781088315183077757961620795782546409894578378688607592378376318836054947676345821548104185464507 1339506544944476473020471379941921221584933875938349620426543736416511423956333506472724655353366534992391756441569", 10);
+		}
 		mclBn_setMapToMode(MCL_MAP_TO_MODE_ETH2);
-		g_PadjInv[0] = g_P;
-		G1::mul(g_PadjInv[1], g_P, mcl::bn::getG2cofactorAdjInv());
+		if (!useInitTbl) {
+			g_PadjInv[0] = g_P;
+			G1::mul(g_PadjInv[1], g_P, mcl::bn::getG2cofactorAdjInv());
+		}
 		g_adjInvIdx = 1;
 	} else
 	#endif
 	{
-		mapToG1(&b, g_P, 1);
-		g_PadjInv[0] = g_P;
+		if (!useInitTbl) {
+			mapToG1(&b, g_P, 1);
+			g_PadjInv[0] = g_P;
+		}
 		g_adjInvIdx = 0;
 	}
 #else
-
-	if (curve == MCL_BN254) {
-		const char *Qx_BN254 = "11ccb44e77ac2c5dc32a6009594dbe331ec85a61290d6bbac8cc7ebb2dceb128 f204a14bbdac4a05be9a25176de827f2e60085668becdd4fc5fa914c9ee0d9a";
-		const char *Qy_BN254 = "7c13d8487903ee3c1c5ea327a3a52b6cc74796b1760d5ba20ed802624ed19c8 8f9642bbaacb73d8c89492528f58932f2de9ac3e80c7b0e41f1a84f1c40182";
-		g_Q.x.setStr(&b, Qx_BN254, 16);
-		g_Q.y.setStr(&b, Qy_BN254, 16);
-		g_Q.z = 1;
-	} else {
-		mapToG2(&b, g_Q, 1);
-	}
-	if (!b) return -100;
+	if (!useInitTbl) {
+		if (curve == MCL_BN254) {
+			const char *Qx_BN254 = "11ccb44e77ac2c5dc32a6009594dbe331ec85a61290d6bbac8cc7ebb2dceb128 f204a14bbdac4a05be9a25176de827f2e60085668becdd4fc5fa914c9ee0d9a";
+			const char *Qy_BN254 = "7c13d8487903ee3c1c5ea327a3a52b6cc74796b1760d5ba20ed802624ed19c8 8f9642bbaacb73d8c89492528f58932f2de9ac3e80c7b0e41f1a84f1c40182";
+			g_Q.x.setStr(&b, Qx_BN254, 16);
+			g_Q.y.setStr(&b, Qy_BN254, 16);
+			g_Q.z = 1;
+		} else {
+			mapToG2(&b, g_Q, 1);
+		}
+		if (!b) return -100;
 #if MCL_SIZEOF_UNIT == 8
-	if (curve == MCL_BN254) {
-		#include "./qcoeff-bn254.hpp"
-		g_Qcoeff.resize(BN::param.precomputedQcoeffSize);
-		assert(g_Qcoeff.size() == CYBOZU_NUM_OF_ARRAY(QcoeffTblBN254));
-		for (size_t i = 0; i < g_Qcoeff.size(); i++) {
-			Fp6& x6 = g_Qcoeff[i];
-			for (size_t j = 0; j < 6; j++) {
-				Fp& x = x6.getFp0()[j];
-				mcl::fp::Unit *p = const_cast<mcl::fp::Unit*>(x.getUnit());
-				for (size_t k = 0; k < 4; k++) {
-					p[k] = QcoeffTblBN254[i][j][k];
+		if (curve == MCL_BN254) {
+			#include "./qcoeff-bn254.hpp"
+			g_Qcoeff.resize(BN::param.precomputedQcoeffSize);
+			assert(g_Qcoeff.size() == CYBOZU_NUM_OF_ARRAY(QcoeffTblBN254));
+			for (size_t i = 0; i < g_Qcoeff.size(); i++) {
+				Fp6& x6 = g_Qcoeff[i];
+				for (size_t j = 0; j < 6; j++) {
+					Fp& x = x6.getFp0()[j];
+					mcl::fp::Unit *p = const_cast<mcl::fp::Unit*>(x.getUnit());
+					for (size_t k = 0; k < 4; k++) {
+						p[k] = QcoeffTblBN254[i][j][k];
+					}
 				}
 			}
-		}
-	} else
+		} else
 #endif
-	{
-		precomputeG2(&b, g_Qcoeff, getBasePoint());
+		{
+			precomputeG2(&b, g_Qcoeff, getBasePoint());
+		}
 	}
 #endif
 	if (!b) return -101;
+#ifndef BLS_MINIMUM_API
+	if (!useInitTbl) initBaseTbl(getBasePoint());
+#endif
+#ifdef BLS_USE_HASH_CACHE
+	g_hashCache.clear(false);
+#endif
 	return 0;
 }
 
@@ -231,25 +717,35 @@ int blsSecretKeySetLittleEndianMod(blsSecretKey *sec, const void *buf, mclSize b
 
 void blsGetPublicKey(blsPublicKey *pub, const blsSecretKey *sec)
 {
+#ifndef BLS_MINIMUM_API
+	mulBase(*cast(&pub->v), *cast(&sec->v));
+#else
 	Gmul(*cast(&pub->v), getBasePoint(), *cast(&sec->v));
+#endif
 }
 
 int blsHashToSignature(blsSignature *sig, const void *buf, mclSize bufSize)
 {
-	hashAndMapToG(*cast(&sig->v), buf, bufSize);
+	hashAndMapToGwithCache(*cast(&sig->v), buf, bufSize);
 	return 0;
 }
 
-void blsSign(blsSignature *sig, const blsSecretKey *sec, const void *m, mclSize size)
+inline void signHashed(blsSignature *sig, const blsSecretKey *sec, const G& Hm)
 {
-	blsHashToSignature(sig, m, size);
 	Fr s = *cast(&sec->v);
 #ifdef BLS_ETH
 	if (g_curveType == MCL_BLS12_381 && !g_newEth2) {
 		s *= mcl::bn::getG2cofactorAdj();
 	}
 #endif
-	GmulCT(*cast(&sig->v), *cast(&sig->v), s);
+	GmulCT(*cast(&sig->v), Hm, s);
+}
+
+void blsSign(blsSignature *sig, const blsSecretKey *sec, const void *m, mclSize size)
+{
+	G Hm;
+	hashAndMapToGwithCache(Hm, m, size);
+	signHashed(sig, sec, Hm);
 }
 
 #ifdef BLS_SWAP_G
@@ -264,8 +760,8 @@ bool isEqualTwoPairings(const G2& sHm, const G1& sP, const G2& Hm)
 	G2 v2[2] = { sHm, Hm };
 	v1[0] = getBasePointAdjInv();
 	G1::neg(v1[1], sP);
-	millerLoopVec(e, v1, v2, 2);
-	finalExp(e, e);
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e, v1, v2, 2));
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, finalExp(e, e));
 	return e.isOne();
 }
 #else
@@ -279,16 +775,92 @@ bool isEqualTwoPairings(const G2& sHm, const G1& sP, const G2& Hm)
 bool isEqualTwoPairings(const G1& P1, const Fp6* Q1coeff, const G1& P2, const G2& Q2)
 {
 	GT e;
-	precomputedMillerLoop2mixed(e, P2, Q2, -P1, Q1coeff);
-	finalExp(e, e);
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, precomputedMillerLoop2mixed(e, P2, Q2, -P1, Q1coeff));
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, finalExp(e, e));
 	return e.isOne();
 }
 #endif
 
-int blsVerify(const blsSignature *sig, const blsPublicKey *pub, const void *m, mclSize size)
+/*
+	e = prod_{i in [begin, end)} ML(P_i, Q_i) where pairs.get(P_i, Q_i, i) sets the i-th pair
+	return false if pairs.get returns false
+	@note begin < end
+*/
+template<class Pairs>
+bool millerLoopPairs(GT& e, const Pairs& pairs, size_t begin, size_t end)
+{
+	const size_t N = 16;
+	G1 g1Vec[N];
+	G2 g2Vec[N];
+	bool first = true;
+	while (begin < end) {
+		size_t m = end - begin;
+		if (m > N) m = N;
+		for (size_t i = 0; i < m; i++) {
+			if (!pairs.get(g1Vec[i], g2Vec[i], begin + i)) return false;
+		}
+		if (first) {
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e, g1Vec, g2Vec, m));
+			first = false;
+		} else {
+			GT e2;
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e2, g1Vec, g2Vec, m));
+			e *= e2;
+		}
+		begin += m;
+	}
+	return true;
+}
+
+#ifdef BLS_USE_THREAD
+template<class Pairs>
+struct MillerLoopPairsTask {
+	const Pairs& pairs;
+	GT *eVec;
+	int *okVec;
+	MillerLoopPairsTask(const Pairs& p, GT *e, int *ok)
+		: pairs(p), eVec(e), okVec(ok)
+	{
+	}
+	void operator()(size_t begin, size_t end, size_t idx)
+	{
+		okVec[idx] = millerLoopPairs(eVec[idx], pairs, begin, end);
+	}
+};
+#endif
+
+/*
+	multi-thread version of millerLoopPairs(e, pairs, 0, n)
+	each thread computes the product for a disjoint range
+	@note 0 < n
+*/
+template<class Pairs>
+bool millerLoopPairsMT(GT& e, const Pairs& pairs, size_t n, size_t threadN)
+{
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		std::vector<GT> eVec(threadN);
+		std::vector<int> okVec(threadN);
+		MillerLoopPairsTask<Pairs> task(pairs, &eVec[0], &okVec[0]);
+		parallelFor(task, n, threadN);
+		for (size_t i = 0; i < threadN; i++) {
+			if (!okVec[i]) return false;
+		}
+		e = eVec[0];
+		for (size_t i = 1; i < threadN; i++) {
+			e *= eVec[i];
+		}
+		return true;
+	}
+#else
+	(void)threadN;
+#endif
+	return millerLoopPairs(e, pairs, 0, n);
+}
+
+inline int verifyHashed(const blsSignature *sig, const blsPublicKey *pub, const G& Hm)
 {
-	G Hm;
-	hashAndMapToG(Hm, m, size);
 #ifdef BLS_SWAP_G
 	return isEqualTwoPairings(*cast(&sig->v), *cast(&pub->v), Hm);
 #else
@@ -300,6 +872,13 @@ int blsVerify(const blsSignature *sig, const blsPublicKey *pub, const void *m, m
 #endif
 }
 
+int blsVerify(const blsSignature *sig, const blsPublicKey *pub, const void *m, mclSize size)
+{
+	G Hm;
+	hashAndMapToGwithCache(Hm, m, size);
+	return verifyHashed(sig, pub, Hm);
+}
+
 void blsAggregateSignature(blsSignature *aggSig, const blsSignature *sigVec, mclSize n)
 {
 	if (n == 0) {
@@ -332,65 +911,90 @@ int blsFastAggregateVerify(const blsSignature *sig, const blsPublicKey *pubVec,
 	return blsVerify(sig, &aggPub, msg, msgSize);
 }
 
-int blsAggregateVerifyNoCheck(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n)
-{
-#ifdef BLS_ETH
-	if (n == 0) return 0;
-#if 1 // 1.1 times faster
-	GT e1;
-	const char *msg = (const char*)msgVec;
-	const size_t N = 16;
-	G1 g1Vec[N];
-	G2 g2Vec[N];
-	size_t start = 1; // 1 if first else 0
+/*
+	the i-th message is msgVec[i * msgSize, (i + 1) * msgSize)
+*/
+struct PackedMsg {
+	const char *msgVec;
+	mclSize msgSize;
+	const void *getPtr(size_t i) const { return &msgVec[i * msgSize]; }
+	mclSize getSize(size_t) const { return msgSize; }
+};
 
-	g1Vec[0] = getBasePoint();
-	G2::neg(g2Vec[0], *cast(&sig->v));
-	while (n > 0) {
-		size_t m = N - start;
-		if (n < m) m = n;
-		for (size_t i = 0; i < m; i++) {
-			g1Vec[i + start] = *cast(&pubVec[i].v);
-			hashAndMapToG(g2Vec[i + start], &msg[i * msgSize], msgSize);
-		}
-		if (start) {
-			millerLoopVec(e1, g1Vec, g2Vec, m + start);
-			start = 0;
+/*
+	the i-th message is msgPtrVec[i][0, msgSizeVec[i])
+*/
+struct PtrMsg {
+	const void *const *msgPtrVec;
+	const mclSize *msgSizeVec;
+	const void *getPtr(size_t i) const { return msgPtrVec[i]; }
+	mclSize getSize(size_t i) const { return msgSizeVec[i]; }
+};
+
+#ifdef BLS_ETH
+/*
+	pairs of blsAggregateVerifyNoCheck
+	0 : (P, -sig)
+	i + 1 : (pubVec[i], H(msg_i)) for i = 0, ..., n - 1
+*/
+template<class Msg>
+struct AggregateVerifyPairs {
+	const blsSignature *sig;
+	const blsPublicKey *pubVec;
+	Msg msg;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+		if (i == 0) {
+			P = getBasePoint();
+			G2::neg(Q, *cast(&sig->v));
 		} else {
-			GT e2;
-			millerLoopVec(e2, g1Vec, g2Vec, m);
-			e1 *= e2;
+			i--;
+			P = *cast(&pubVec[i].v);
+			hashAndMapToGwithCache(Q, msg.getPtr(i), msg.getSize(i));
 		}
-		pubVec += m;
-		msg += m * msgSize;
-		n -= m;
-	}
-	BN::finalExp(e1, e1);
-	return e1.isOne();
-#else
-	const char *p = (const char *)msgVec;
-	GT s(1), t;
-	for (mclSize i = 0; i < n; i++) {
-		G2 Q;
-		hashAndMapToG(Q, &p[msgSize * i], msgSize);
-		millerLoop(t, *cast(&pubVec[i].v), Q);
-		s *= t;
+		return true;
 	}
-	millerLoop(t, -getBasePoint(), *cast(&sig->v));
-	s *= t;
-	finalExp(s, s);
-	return s.isOne() ? 1 : 0;
+};
 #endif
+
+template<class Msg>
+int aggregateVerifyNoCheck(const blsSignature *sig, const blsPublicKey *pubVec, const Msg& msg, mclSize n, mclSize threadN)
+{
+#ifdef BLS_ETH
+	if (n == 0) return 0;
+	const AggregateVerifyPairs<Msg> pairs = { sig, pubVec, msg };
+	GT e;
+	millerLoopPairsMT(e, pairs, n + 1, threadN);
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e, e));
+	return e.isOne();
 #else
 	(void)sig;
 	(void)pubVec;
-	(void)msgVec;
-	(void)msgSize;
+	(void)msg;
 	(void)n;
+	(void)threadN;
 	return 0;
 #endif
 }
 
+int blsAggregateVerifyNoCheck(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n)
+{
+	const PackedMsg msg = { (const char*)msgVec, msgSize };
+	return aggregateVerifyNoCheck(sig, pubVec, msg, n, 1);
+}
+
+int blsAggregateVerifyNoCheckPtr(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n)
+{
+	const PtrMsg msg = { msgPtrVec, msgSizeVec };
+	return aggregateVerifyNoCheck(sig, pubVec, msg, n, 1);
+}
+
+int blsAggregateVerifyNoCheckPtrMT(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n, mclSize threadN)
+{
+	const PtrMsg msg = { msgPtrVec, msgSizeVec };
+	return aggregateVerifyNoCheck(sig, pubVec, msg, n, threadN);
+}
+
 mclSize blsIdSerialize(void *buf, mclSize maxBufSize, const blsId *id)
 {
 	return cast(&id->v)->serialize(buf, maxBufSize);
@@ -423,12 +1027,16 @@ mclSize blsSecretKeyDeserialize(blsSecretKey *sec, const void *buf, mclSize bufS
 
 mclSize blsPublicKeyDeserialize(blsPublicKey *pub, const void *buf, mclSize bufSize)
 {
-	return cast(&pub->v)->deserialize(buf, bufSize);
+	mclSize n;
+	BLS_STATS_CALL(BLS_STATS_DESERIALIZE, n = cast(&pub->v)->deserialize(buf, bufSize));
+	return n;
 }
 
 mclSize blsSignatureDeserialize(blsSignature *sig, const void *buf, mclSize bufSize)
 {
-	return cast(&sig->v)->deserialize(buf, bufSize);
+	mclSize n;
+	BLS_STATS_CALL(BLS_STATS_DESERIALIZE, n = cast(&sig->v)->deserialize(buf, bufSize));
+	return n;
 }
 
 int blsIdIsEqual(const blsId *lhs, const blsId *rhs)
@@ -519,106 +1127,486 @@ void blsPublicKeyVerifyOrder(int doVerify)
 }
 int blsSignatureIsValidOrder(const blsSignature *sig)
 {
-	return cast(&sig->v)->isValidOrder();
+	bool b;
+	BLS_STATS_CALL(BLS_STATS_ORDER_CHECK, b = cast(&sig->v)->isValidOrder());
+	return b;
 }
 int blsPublicKeyIsValidOrder(const blsPublicKey *pub)
 {
-	return cast(&pub->v)->isValidOrder();
+	bool b;
+	BLS_STATS_CALL(BLS_STATS_ORDER_CHECK, b = cast(&pub->v)->isValidOrder());
+	return b;
 }
 
 #ifndef BLS_MINIMUM_API
+void blsPublicKeyNormalizeVec(blsPublicKey *pubVec, mclSize n)
+{
+	normalizeVec(cast(&pubVec[0].v), n);
+}
+
+void blsSignatureNormalizeVec(blsSignature *sigVec, mclSize n)
+{
+	normalizeVec(cast(&sigVec[0].v), n);
+}
+
 template<class G>
 inline bool toG(G& Hm, const void *h, mclSize size)
 {
 	bool b;
 #ifdef BLS_ETH
 	if (g_newEth2) {
-		BN::hashAndMapToG2(Hm, h, size);
+		BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, BN::hashAndMapToG2(Hm, h, size));
 		return true;
 	}
 	Fp2 t;
 	if (t.deserialize(h, size) == 0) return false;
-	BN::mapToG2(&b, Hm, t, true);
+	BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, BN::mapToG2(&b, Hm, t, true));
 #elif defined(BLS_SWAP_G)
 	Fp t;
 	t.setArrayMask((const char *)h, size);
-	BN::mapToG2(&b, Hm, Fp2(t, 0));
+	BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, BN::mapToG2(&b, Hm, Fp2(t, 0)));
 #else
 	Fp t;
 	t.setArrayMask((const char *)h, size);
-	BN::mapToG1(&b, Hm, t);
+	BLS_STATS_CALL(BLS_STATS_HASH_TO_CURVE, BN::mapToG1(&b, Hm, t));
 #endif
 	return b;
 }
 
-int blsVerifyAggregatedHashes(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *hVec, size_t sizeofHash, mclSize n)
+/*
+	pairs of blsVerifyAggregatedHashes
+	swap
+	0 : (P, -aggSig)
+	i + 1 : (pubVec[i], toG(hVec[i])) for i = 0, ..., n - 1
+	not swap
+	i : (toG(hVec[i]), pubVec[i]) for i = 0, ..., n - 1
+*/
+template<class Msg>
+struct AggregatedHashesPairs {
+	const blsSignature *aggSig;
+	const blsPublicKey *pubVec;
+	Msg h;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+#ifdef BLS_SWAP_G
+		if (i == 0) {
+			P = getBasePointAdjInv();
+			G2::neg(Q, *cast(&aggSig->v));
+			return true;
+		}
+		i--;
+		P = *cast(&pubVec[i].v);
+		return toG(Q, h.getPtr(i), h.getSize(i));
+#else
+		Q = *cast(&pubVec[i].v);
+		return toG(P, h.getPtr(i), h.getSize(i));
+#endif
+	}
+};
+
+template<class Msg>
+int verifyAggregatedHashes(const blsSignature *aggSig, const blsPublicKey *pubVec, const Msg& h, mclSize n, mclSize threadN)
 {
 	if (n == 0) return 0;
+	const AggregatedHashesPairs<Msg> pairs = { aggSig, pubVec, h };
 	GT e1;
-	const char *ph = (const char*)hVec;
+#ifdef BLS_SWAP_G
+	if (!millerLoopPairsMT(e1, pairs, n + 1, threadN)) return 0;
+#else
+	/*
+		e(aggSig, Q) = prod_i e(hVec[i], pubVec[i])
+		<=> finalExp(ML(-aggSig, Q) * prod_i ML(hVec[i], pubVec[i])) == 1
+	*/
+	if (!millerLoopPairsMT(e1, pairs, n, threadN)) return 0;
+	GT e2;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e2, -*cast(&aggSig->v), g_Qcoeff.data()));
+	e1 *= e2;
+#endif
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e1, e1));
+	return e1.isOne();
+}
+
+int blsVerifyAggregatedHashes(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *hVec, size_t sizeofHash, mclSize n)
+{
+	const PackedMsg h = { (const char*)hVec, sizeofHash };
+	return verifyAggregatedHashes(aggSig, pubVec, h, n, 1);
+}
+
+int blsVerifyAggregatedHashesMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *hVec, size_t sizeofHash, mclSize n, mclSize threadN)
+{
+	const PackedMsg h = { (const char*)hVec, sizeofHash };
+	return verifyAggregatedHashes(aggSig, pubVec, h, n, threadN);
+}
+
+int blsVerifyAggregatedHashesPtr(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *const *hPtrVec, const mclSize *hSizeVec, mclSize n)
+{
+	const PtrMsg h = { hPtrVec, hSizeVec };
+	return verifyAggregatedHashes(aggSig, pubVec, h, n, 1);
+}
+
+int blsVerifyAggregatedHashesPtrMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const void *const *hPtrVec, const mclSize *hSizeVec, mclSize n, mclSize threadN)
+{
+	const PtrMsg h = { hPtrVec, hSizeVec };
+	return verifyAggregatedHashes(aggSig, pubVec, h, n, threadN);
+}
+
+int blsAggregateVerifyNoCheckMT(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n, mclSize threadN)
+{
+	const PackedMsg msg = { (const char*)msgVec, msgSize };
+	return aggregateVerifyNoCheck(sig, pubVec, msg, n, threadN);
+}
+
+template<class T>
+struct DeserializeTask {
+	typedef mclSize (*Deserialize)(T *x, const void *buf, mclSize bufSize);
+	Deserialize f;
+	T *xVec;
+	int *okVec;
+	const char *buf;
+	mclSize stride;
+	void operator()(size_t begin, size_t end, size_t)
+	{
+		for (size_t i = begin; i < end; i++) {
+			okVec[i] = f(&xVec[i], &buf[i * stride], stride) > 0;
+		}
+	}
+};
+
+template<class T>
+mclSize deserializeVec(DeserializeTask<T>& task, mclSize n, mclSize threadN)
+{
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		parallelFor(task, n, threadN);
+	} else {
+		task(0, n, 0);
+	}
+#else
+	(void)threadN;
+	task(0, n, 0);
+#endif
+	mclSize okN = 0;
+	for (mclSize i = 0; i < n; i++) {
+		okN += task.okVec[i];
+	}
+	return okN;
+}
+
+mclSize blsPublicKeyDeserializeVec(blsPublicKey *pubVec, int *okVec, const void *buf, mclSize stride, mclSize n, mclSize threadN)
+{
+	DeserializeTask<blsPublicKey> task = { blsPublicKeyDeserialize, pubVec, okVec, (const char*)buf, stride };
+	return deserializeVec(task, n, threadN);
+}
+
+mclSize blsSignatureDeserializeVec(blsSignature *sigVec, int *okVec, const void *buf, mclSize stride, mclSize n, mclSize threadN)
+{
+	DeserializeTask<blsSignature> task = { blsSignatureDeserialize, sigVec, okVec, (const char*)buf, stride };
+	return deserializeVec(task, n, threadN);
+}
+
+/*
+	serialize xVec[begin, end) after normalizing each N elements at once
+	okNVec[idx] = the number of successes
+*/
+template<class T>
+struct SerializeTask {
+	typedef mclSize (*Serialize)(void *buf, mclSize maxBufSize, const T *x);
+	Serialize f;
+	char *buf;
+	mclSize stride;
+	const T *xVec;
+	mclSize *okNVec;
+	void operator()(size_t begin, size_t end, size_t idx)
+	{
+		const size_t N = 64;
+		T tmp[N];
+		mclSize okN = 0;
+		while (begin < end) {
+			size_t m = end - begin;
+			if (m > N) m = N;
+			for (size_t i = 0; i < m; i++) {
+				tmp[i] = xVec[begin + i];
+			}
+			normalizeVec(cast(&tmp[0].v), m);
+			for (size_t i = 0; i < m; i++) {
+				okN += f(&buf[(begin + i) * stride], stride, &tmp[i]) > 0;
+			}
+			begin += m;
+		}
+		okNVec[idx] = okN;
+	}
+};
+
+template<class T>
+mclSize serializeVec(SerializeTask<T>& task, mclSize n, mclSize threadN)
+{
+	mclSize okN = 0;
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		std::vector<mclSize> okNVec(threadN);
+		task.okNVec = &okNVec[0];
+		parallelFor(task, n, threadN);
+		for (size_t i = 0; i < threadN; i++) {
+			okN += okNVec[i];
+		}
+		return okN == n ? n * task.stride : 0;
+	}
+#else
+	(void)threadN;
+#endif
+	task.okNVec = &okN;
+	task(0, n, 0);
+	return okN == n ? n * task.stride : 0;
+}
+
+mclSize blsPublicKeySerializeVec(void *buf, mclSize stride, const blsPublicKey *pubVec, mclSize n, mclSize threadN)
+{
+	SerializeTask<blsPublicKey> task = { blsPublicKeySerialize, (char*)buf, stride, pubVec, 0 };
+	return serializeVec(task, n, threadN);
+}
+
+mclSize blsSignatureSerializeVec(void *buf, mclSize stride, const blsSignature *sigVec, mclSize n, mclSize threadN)
+{
+	SerializeTask<blsSignature> task = { blsSignatureSerialize, (char*)buf, stride, sigVec, 0 };
+	return serializeVec(task, n, threadN);
+}
+
+mclSize blsPublicKeySerializeUncompressedVec(void *buf, mclSize stride, const blsPublicKey *pubVec, mclSize n, mclSize threadN)
+{
+	SerializeTask<blsPublicKey> task = { blsPublicKeySerializeUncompressed, (char*)buf, stride, pubVec, 0 };
+	return serializeVec(task, n, threadN);
+}
+
+mclSize blsSignatureSerializeUncompressedVec(void *buf, mclSize stride, const blsSignature *sigVec, mclSize n, mclSize threadN)
+{
+	SerializeTask<blsSignature> task = { blsSignatureSerializeUncompressed, (char*)buf, stride, sigVec, 0 };
+	return serializeVec(task, n, threadN);
+}
+
+struct GetPublicKeyTask {
+	blsPublicKey *pubVec;
+	const blsSecretKey *secVec;
+	void operator()(size_t begin, size_t end, size_t)
+	{
+		for (size_t i = begin; i < end; i++) {
+			blsGetPublicKey(&pubVec[i], &secVec[i]);
+		}
+	}
+};
+
+void blsGetPublicKeyVec(blsPublicKey *pubVec, const blsSecretKey *secVec, mclSize n, mclSize threadN)
+{
+	GetPublicKeyTask task = { pubVec, secVec };
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		parallelFor(task, n, threadN);
+		return;
+	}
+#else
+	(void)threadN;
+#endif
+	task(0, n, 0);
+}
+
+struct SignTask {
+	blsSignature *sigVec;
+	const blsSecretKey *secVec;
+	PtrMsg msg;
+	void operator()(size_t begin, size_t end, size_t)
+	{
+		G Hm;
+		for (size_t i = begin; i < end; i++) {
+			hashAndMapToGwithCache(Hm, msg.getPtr(i), msg.getSize(i));
+			signHashed(&sigVec[i], &secVec[i], Hm);
+		}
+	}
+};
+
+void blsSignVec(blsSignature *sigVec, const blsSecretKey *secVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n, mclSize threadN)
+{
+	const PtrMsg msg = { msgPtrVec, msgSizeVec };
+	SignTask task = { sigVec, secVec, msg };
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		parallelFor(task, n, threadN);
+		return;
+	}
+#else
+	(void)threadN;
+#endif
+	task(0, n, 0);
+}
+
+// sigVec[i] = the signature of Hm by secVec[i] for i in [begin, end)
+struct SignSameTask {
+	blsSignature *sigVec;
+	const blsSecretKey *secVec;
+	const G *Hm;
+	void operator()(size_t begin, size_t end, size_t)
+	{
+		for (size_t i = begin; i < end; i++) {
+			signHashed(&sigVec[i], &secVec[i], *Hm);
+		}
+	}
+};
+
+void signSameMT(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const G& Hm, mclSize threadN)
+{
+	SignSameTask task = { sigVec, secVec, &Hm };
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		parallelFor(task, n, threadN);
+		return;
+	}
+#else
+	(void)threadN;
+#endif
+	task(0, n, 0);
+}
+
+void blsSignSameMessageMT(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *m, mclSize size, mclSize threadN)
+{
+	G Hm;
+	hashAndMapToGwithCache(Hm, m, size);
+	signSameMT(sigVec, secVec, n, Hm, threadN);
+}
+
+void blsSignSameMessage(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *m, mclSize size)
+{
+	blsSignSameMessageMT(sigVec, secVec, n, m, size, 1);
+}
+
+int blsSignHashSameMessageMT(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *h, mclSize size, mclSize threadN)
+{
+	G Hm;
+	if (!toG(Hm, h, size)) return -1;
+	signSameMT(sigVec, secVec, n, Hm, threadN);
+	return 0;
+}
+
+int blsSignHashSameMessage(blsSignature *sigVec, const blsSecretKey *secVec, mclSize n, const void *h, mclSize size)
+{
+	return blsSignHashSameMessageMT(sigVec, secVec, n, h, size, 1);
+}
+
+#ifndef MCL_DONT_USE_CSPRNG
+/*
+	set a random 64-bit value to r
+	the lowest 64 bits of a random Fr are almost uniform
+*/
+inline bool setRandScalar(Fr& r)
+{
+	Fr t;
+	bool b;
+	t.setByCSPRNG(&b);
+	if (!b) return false;
+	r.setArrayMask((const char *)t.getUnit(), 8);
+	return true;
+}
+
+/*
+	e(P, sig_i) = e(pub_i, H_i) for all i
+	<= e(P, sum_i r_i sig_i) = prod_i e(r_i pub_i, H_i) (swap)
+	<= e(sum_i r_i sig_i, Q) = prod_i e(r_i H_i, pub_i) (not swap)
+	r_i is multiplied to the element in G1
+*/
+template<class Msg>
+int batchVerify(const blsSignature *sigVec, const blsPublicKey *pubVec, const Msg& msg, mclSize n)
+{
+	if (n == 0) return 0;
 	const size_t N = 16;
 	G1 g1Vec[N];
 	G2 g2Vec[N];
-#ifdef BLS_SWAP_G
-	size_t start = 1; // 1 if first else 0
-
-	g1Vec[0] = getBasePointAdjInv();
-	G2::neg(g2Vec[0], *cast(&aggSig->v));
-	while (n > 0) {
-		size_t m = N - start;
-		if (n < m) m = n;
+	Fr rVec[N];
+	G aggSig;
+	aggSig.clear();
+	GT e1, e2;
+	size_t pos = 0;
+	while (pos < n) {
+		size_t m = n - pos;
+		if (m > N) m = N;
 		for (size_t i = 0; i < m; i++) {
-			g1Vec[i + start] = *cast(&pubVec[i].v);
-			if (!toG(g2Vec[i + start], &ph[i * sizeofHash], sizeofHash)) return 0;
+			if (!setRandScalar(rVec[i])) return 0;
+			const void *p = msg.getPtr(pos + i);
+			const mclSize msgSize = msg.getSize(pos + i);
+#ifdef BLS_SWAP_G
+			G1::mul(g1Vec[i], *cast(&pubVec[pos + i].v), rVec[i]);
+			hashAndMapToGwithCache(g2Vec[i], p, msgSize);
+#else
+			hashAndMapToGwithCache(g1Vec[i], p, msgSize);
+			G1::mul(g1Vec[i], g1Vec[i], rVec[i]);
+			g2Vec[i] = *cast(&pubVec[pos + i].v);
+#endif
 		}
-		if (start) {
-			millerLoopVec(e1, g1Vec, g2Vec, m + start);
-			start = 0;
+		G sub;
+		G::mulVec(sub, cast(&sigVec[pos].v), rVec, m);
+		aggSig += sub;
+		if (pos == 0) {
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e1, g1Vec, g2Vec, m));
 		} else {
-			GT e2;
-			millerLoopVec(e2, g1Vec, g2Vec, m);
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e2, g1Vec, g2Vec, m));
 			e1 *= e2;
 		}
-		pubVec += m;
-		ph += m * sizeofHash;
-		n -= m;
+		pos += m;
 	}
+#ifdef BLS_SWAP_G
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoop(e2, -getBasePointAdjInv(), aggSig));
 #else
-	/*
-		e(aggSig, Q) = prod_i e(hVec[i], pubVec[i])
-		<=> finalExp(ML(-aggSig, Q) * prod_i ML(hVec[i], pubVec[i])) == 1
-	*/
-	BN::precomputedMillerLoop(e1, -*cast(&aggSig->v), g_Qcoeff.data());
-	while (n > 0) {
-		size_t m = N;
-		if (n < m) m = n;
-		for (size_t i = 0; i < m; i++) {
-			if (!toG(g1Vec[i], &ph[i * sizeofHash], sizeofHash)) return 0;
-			g2Vec[i] = *cast(&pubVec[i].v);
-		}
-		GT e2;
-		millerLoopVec(e2, g1Vec, g2Vec, m);
-		e1 *= e2;
-		pubVec += m;
-		ph += m * sizeofHash;
-		n -= m;
-	}
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e2, -aggSig, getQcoeff().data()));
 #endif
-	BN::finalExp(e1, e1);
+	e1 *= e2;
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e1, e1));
 	return e1.isOne();
 }
 
+/*
+	the i-th message is the next msgSizeVec[i] bytes of msgVec after the (i - 1)-th message
+	@note i must be given in increasing order
+*/
+class ConcatMsg {
+	const char *msgVec_;
+	const mclSize *msgSizeVec_;
+	mutable const char *p_;
+	mutable size_t i_;
+public:
+	ConcatMsg(const void *msgVec, const mclSize *msgSizeVec)
+		: msgVec_((const char*)msgVec), msgSizeVec_(msgSizeVec), p_(msgVec_), i_(0)
+	{
+	}
+	const void *getPtr(size_t i) const
+	{
+		assert(i_ <= i);
+		while (i_ < i) {
+			p_ += msgSizeVec_[i_++];
+		}
+		return p_;
+	}
+	mclSize getSize(size_t i) const { return msgSizeVec_[i]; }
+};
+
+int blsBatchVerify(const blsSignature *sigVec, const blsPublicKey *pubVec, const void *msgVec, const mclSize *msgSizeVec, mclSize n)
+{
+	const ConcatMsg msg(msgVec, msgSizeVec);
+	return batchVerify(sigVec, pubVec, msg, n);
+}
+
+int blsBatchVerifyPtr(const blsSignature *sigVec, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n)
+{
+	const PtrMsg msg = { msgPtrVec, msgSizeVec };
+	return batchVerify(sigVec, pubVec, msg, n);
+}
+#endif
+
 int blsSignHash(blsSignature *sig, const blsSecretKey *sec, const void *h, mclSize size)
 {
 	G Hm;
 	if (!toG(Hm, h, size)) return -1;
-	Fr s = *cast(&sec->v);
-#ifdef BLS_ETH
-	if (g_curveType == MCL_BLS12_381 && !g_newEth2) {
-		s *= mcl::bn::getG2cofactorAdj();
-	}
-#endif
-	GmulCT(*cast(&sig->v), Hm, s);
+	signHashed(sig, sec, Hm);
 	return 0;
 }
 
@@ -748,88 +1736,842 @@ inline void blsHashWithDomainToFp2(uint8_t buf[96], const uint8_t hashWithDomain
 	memset(buf, 0, 16);
 
 	msg[40] = '\x02';
-	mcl::fp::sha256(buf + 16, 32, msg, 41); // im part
+	bls::sha256::sha256(buf + 16, 32, msg, 41); // im part
 
 	memset(buf + 48, 0, 16);
 	msg[40] = '\x01';
-	mcl::fp::sha256(buf + 64, 32, msg, 41); // re part
+	bls::sha256::sha256(buf + 64, 32, msg, 41); // re part
+}
+#endif
+
+int blsSignHashWithDomain(blsSignature *sig, const blsSecretKey *sec, const uint8_t hashWithDomain[40])
+{
+#ifdef BLS_ETH
+	if (g_curveType != MCL_BLS12_381) return -1;
+	uint8_t msg[96];
+	blsHashWithDomainToFp2(msg, hashWithDomain);
+	return blsSignHash(sig, sec, msg, sizeof(msg));
+#else
+	(void)sig;
+	(void)sec;
+	(void)hashWithDomain;
+	return -1;
+#endif
 }
+
+int blsVerifyHashWithDomain(const blsSignature *sig, const blsPublicKey *pub, const uint8_t hashWithDomain[40])
+{
+#ifdef BLS_ETH
+	if (g_curveType != MCL_BLS12_381) return 0;
+	uint8_t msg[96];
+	blsHashWithDomainToFp2(msg, hashWithDomain);
+	return blsVerifyHash(sig, pub, msg, sizeof(msg));
+#else
+	(void)sig;
+	(void)pub;
+	(void)hashWithDomain;
+	return 0;
+#endif
+}
+
+#ifdef BLS_ETH
+/*
+	pairs of blsVerifyAggregatedHashWithDomain
+	0 : (P, -aggSig)
+	i + 1 : (pubVec[i], toG(hashWithDomain[i])) for i = 0, ..., n - 1
+*/
+template<class Msg>
+struct AggregatedHashWithDomainPairs {
+	const blsSignature *aggSig;
+	const blsPublicKey *pubVec;
+	Msg hashWithDomain;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+		if (i == 0) {
+			P = getBasePointAdjInv();
+			G2::neg(Q, *cast(&aggSig->v));
+			return true;
+		}
+		i--;
+		P = *cast(&pubVec[i].v);
+		uint8_t buf[96];
+		blsHashWithDomainToFp2(buf, (const uint8_t*)hashWithDomain.getPtr(i));
+		return toG(Q, buf, sizeof(buf));
+	}
+};
 #endif
 
-int blsSignHashWithDomain(blsSignature *sig, const blsSecretKey *sec, const uint8_t hashWithDomain[40])
+template<class Msg>
+int verifyAggregatedHashWithDomain(const blsSignature *aggSig, const blsPublicKey *pubVec, const Msg& hashWithDomain, mclSize n, mclSize threadN)
+{
+#ifdef BLS_ETH
+	if (g_curveType != MCL_BLS12_381) return 0;
+	if (n == 0) return 0;
+	const AggregatedHashWithDomainPairs<Msg> pairs = { aggSig, pubVec, hashWithDomain };
+	GT e;
+	if (!millerLoopPairsMT(e, pairs, n + 1, threadN)) return 0;
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e, e));
+	return e.isOne();
+#else
+	(void)aggSig;
+	(void)pubVec;
+	(void)hashWithDomain;
+	(void)n;
+	(void)threadN;
+	return 0;
+#endif
+}
+
+/*
+	the i-th message is hashWithDomainPtrVec[i][0, 40)
+*/
+struct HashWithDomainPtr {
+	const unsigned char *const *hashWithDomainPtrVec;
+	const void *getPtr(size_t i) const { return hashWithDomainPtrVec[i]; }
+	mclSize getSize(size_t) const { return 40; }
+};
+
+int blsVerifyAggregatedHashWithDomainMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char hashWithDomain[][40], mclSize n, mclSize threadN)
+{
+	const PackedMsg h = { (const char*)hashWithDomain, 40 };
+	return verifyAggregatedHashWithDomain(aggSig, pubVec, h, n, threadN);
+}
+
+int blsVerifyAggregatedHashWithDomain(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char hashWithDomain[][40], mclSize n)
+{
+	return blsVerifyAggregatedHashWithDomainMT(aggSig, pubVec, hashWithDomain, n, 1);
+}
+
+int blsVerifyAggregatedHashWithDomainPtr(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char *const *hashWithDomainPtrVec, mclSize n)
+{
+	return blsVerifyAggregatedHashWithDomainPtrMT(aggSig, pubVec, hashWithDomainPtrVec, n, 1);
+}
+
+int blsVerifyAggregatedHashWithDomainPtrMT(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char *const *hashWithDomainPtrVec, mclSize n, mclSize threadN)
+{
+	const HashWithDomainPtr h = { hashWithDomainPtrVec };
+	return verifyAggregatedHashWithDomain(aggSig, pubVec, h, n, threadN);
+}
+
+#ifndef BLS_SWAP_G
+int blsPublicKeyPrecompute(blsPublicKeyPrecomputed *ppub, const blsPublicKey *pub)
+{
+	if (BN::param.precomputedQcoeffSize * sizeof(Fp6) > sizeof(ppub->v)) return -1;
+	precomputeG2(cast(ppub->v), *cast(&pub->v));
+	return 0;
+}
+
+/*
+	e(sig, Q) = e(Hm, pub)
+	<=> finalExp(ML(Hm, pub) * ML(-sig, Q)) == 1
+	both pub and Q are precomputed
+*/
+int blsVerifyPrecomputed(const blsSignature *sig, const blsPublicKeyPrecomputed *ppub, const void *m, mclSize size)
+{
+	G1 Hm;
+	hashAndMapToGwithCache(Hm, m, size);
+	GT e;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, precomputedMillerLoop2(e, Hm, cast(ppub->v), -*cast(&sig->v), getQcoeff().data()));
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, finalExp(e, e));
+	return e.isOne();
+}
+
+/*
+	e(sig, Q) = prod_i e(H(msg_i), pub_i)
+	<=> finalExp(ML(-sig, Q) * prod_i ML(H(msg_i), pub_i)) == 1
+	compute two Miller loops at once
+*/
+int blsAggregateVerifyNoCheckPrecomputed(const blsSignature *sig, const blsPublicKeyPrecomputed *ppubVec, const void *msgVec, mclSize msgSize, mclSize n)
+{
+	if (n == 0) return 0;
+	const char *msg = (const char *)msgVec;
+	GT e1, e2;
+	G1 H1, H2;
+	hashAndMapToGwithCache(H1, msg, msgSize);
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, precomputedMillerLoop2(e1, -*cast(&sig->v), getQcoeff().data(), H1, cast(ppubVec[0].v)));
+	for (size_t i = 1; i < n; i += 2) {
+		hashAndMapToGwithCache(H1, &msg[i * msgSize], msgSize);
+		if (i + 1 < n) {
+			hashAndMapToGwithCache(H2, &msg[(i + 1) * msgSize], msgSize);
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, precomputedMillerLoop2(e2, H1, cast(ppubVec[i].v), H2, cast(ppubVec[i + 1].v)));
+		} else {
+			BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, precomputedMillerLoop(e2, H1, cast(ppubVec[i].v)));
+		}
+		e1 *= e2;
+	}
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, finalExp(e1, e1));
+	return e1.isOne();
+}
+#endif
+
+int blsMessageSet(blsMessage *msg, const void *m, mclSize size)
+{
+	hashAndMapToGwithCache(*cast(&msg->v), m, size);
+	return 0;
+}
+
+void blsSignMessage(blsSignature *sig, const blsSecretKey *sec, const blsMessage *msg)
+{
+	signHashed(sig, sec, *cast(&msg->v));
+}
+
+int blsVerifyMessage(const blsSignature *sig, const blsPublicKey *pub, const blsMessage *msg)
+{
+	return verifyHashed(sig, pub, *cast(&msg->v));
+}
+
+int blsFastAggregateVerifyMessage(const blsSignature *sig, const blsPublicKey *pubVec, mclSize n, const blsMessage *msg)
+{
+	if (n == 0) return 0;
+	blsPublicKey aggPub;
+	blsAggregatePublicKey(&aggPub, pubVec, n);
+	return verifyHashed(sig, &aggPub, *cast(&msg->v));
+}
+
+/*
+	pairs of blsAggregateVerifyNoCheckMessage
+	swap
+	0 : (P, -sig)
+	i + 1 : (pubVec[i], msgVec[i]) for i = 0, ..., n - 1
+	not swap
+	i : (msgVec[i], pubVec[i]) for i = 0, ..., n - 1
+*/
+struct MessagePairs {
+	const blsSignature *sig;
+	const blsPublicKey *pubVec;
+	const blsMessage *msgVec;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+#ifdef BLS_SWAP_G
+		if (i == 0) {
+			P = getBasePointAdjInv();
+			G2::neg(Q, *cast(&sig->v));
+			return true;
+		}
+		i--;
+		P = *cast(&pubVec[i].v);
+		Q = *cast(&msgVec[i].v);
+#else
+		P = *cast(&msgVec[i].v);
+		Q = *cast(&pubVec[i].v);
+#endif
+		return true;
+	}
+};
+
+int blsAggregateVerifyNoCheckMessage(const blsSignature *sig, const blsPublicKey *pubVec, const blsMessage *msgVec, mclSize n)
+{
+	if (n == 0) return 0;
+	const MessagePairs pairs = { sig, pubVec, msgVec };
+	GT e1;
+#ifdef BLS_SWAP_G
+	millerLoopPairs(e1, pairs, 0, n + 1);
+#else
+	millerLoopPairs(e1, pairs, 0, n);
+	GT e2;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e2, -*cast(&sig->v), getQcoeff().data()));
+	e1 *= e2;
+#endif
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e1, e1));
+	return e1.isOne();
+}
+
+void blsAggVerifyInit(blsAggVerifyContext *ctx, const blsSignature *sig)
+{
+	if (sig) {
+		ctx->sig = *sig;
+	} else {
+		cast(&ctx->sig.v)->clear();
+	}
+	ctx->n = 0;
+	ctx->bufN = 0;
+}
+
+/*
+	multiply ctx->e by the Miller loops of the buffered pairs
+	ctx->e is set if and only if ctx->n > ctx->bufN
+*/
+inline void aggVerifyFlush(blsAggVerifyContext *ctx)
+{
+	const size_t m = ctx->bufN;
+	if (m == 0) return;
+	GT e;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e, cast(ctx->g1Vec), cast(ctx->g2Vec), m));
+	if (ctx->n == m) {
+		*cast(&ctx->e) = e;
+	} else {
+		*cast(&ctx->e) *= e;
+	}
+	ctx->bufN = 0;
+}
+
+inline void aggVerifyAddPair(blsAggVerifyContext *ctx, const G1& P, const G2& Q)
+{
+	*cast(&ctx->g1Vec[ctx->bufN]) = P;
+	*cast(&ctx->g2Vec[ctx->bufN]) = Q;
+	ctx->bufN++;
+	ctx->n++;
+	if (ctx->bufN == BLS_AGG_VERIFY_BUF_N) aggVerifyFlush(ctx);
+}
+
+void blsAggVerifyUpdate(blsAggVerifyContext *ctx, const blsPublicKey *pub, const void *msg, mclSize msgSize)
+{
+	G Hm;
+	hashAndMapToGwithCache(Hm, msg, msgSize);
+#ifdef BLS_SWAP_G
+	aggVerifyAddPair(ctx, *cast(&pub->v), Hm);
+#else
+	aggVerifyAddPair(ctx, Hm, *cast(&pub->v));
+#endif
+}
+
+void blsAggVerifyMerge(blsAggVerifyContext *ctx, const blsAggVerifyContext *rhs)
+{
+	*cast(&ctx->sig.v) += *cast(&rhs->sig.v);
+	const size_t flushedN = rhs->n - rhs->bufN;
+	if (flushedN > 0) {
+		if (ctx->n == ctx->bufN) {
+			ctx->e = rhs->e;
+		} else {
+			*cast(&ctx->e) *= *cast(&rhs->e);
+		}
+		ctx->n += flushedN;
+	}
+	for (size_t i = 0; i < rhs->bufN; i++) {
+		aggVerifyAddPair(ctx, *cast(&rhs->g1Vec[i]), *cast(&rhs->g2Vec[i]));
+	}
+}
+
+/*
+	finalExp(e * ML(buffered pairs) * ML(P, -sig)) == 1
+*/
+int blsAggVerifyFinal(const blsAggVerifyContext *ctx)
+{
+	if (ctx->n == 0) return 0;
+	GT e;
+#ifdef BLS_SWAP_G
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoop(e, getBasePointAdjInv(), -*cast(&ctx->sig.v)));
+#else
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e, -*cast(&ctx->sig.v), getQcoeff().data()));
+#endif
+	if (ctx->n > ctx->bufN) e *= *cast(&ctx->e);
+	if (ctx->bufN > 0) {
+		GT e2;
+		BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, millerLoopVec(e2, cast(ctx->g1Vec), cast(ctx->g2Vec), ctx->bufN));
+		e *= e2;
+	}
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e, e));
+	return e.isOne();
+}
+
+inline uint64_t hashBytes(const void *p, size_t n)
+{
+	// FNV-1a
+	const uint8_t *x = (const uint8_t*)p;
+	uint64_t h = 0xcbf29ce484222325ull;
+	for (size_t i = 0; i < n; i++) {
+		h = (h ^ x[i]) * 0x100000001b3ull;
+	}
+	return h;
+}
+
+/*
+	pubVec[i] and the i-th message of msg
+*/
+template<class Msg>
+struct Ungrouped {
+	const Msg& msg;
+	const blsPublicKey *pubVec;
+	size_t n;
+	size_t size() const { return n; }
+	const void *getPtr(size_t i) const { return msg.getPtr(i); }
+	mclSize getSize(size_t i) const { return msg.getSize(i); }
+	const Gother& getPub(size_t i) const { return *cast(&pubVec[i].v); }
+};
+
+/*
+	the distinct messages of msg and the sum of the public keys of each of them
+	the j-th distinct message is the idxVec_[j]-th message
+	they are found by a hash table of the message bytes
+*/
+template<class Msg>
+class MessageGroup {
+	const Msg& msg_;
+	std::vector<uint32_t> idxVec_;
+	std::vector<Gother> aggPubVec_;
+	size_t n_;
+	bool isEqual(size_t i, const void *p, mclSize size) const
+	{
+		return msg_.getSize(i) == size && memcmp(msg_.getPtr(i), p, size) == 0;
+	}
+public:
+	explicit MessageGroup(const Msg& msg) : msg_(msg), n_(0) {}
+	// return false if it fails to allocate memory
+	bool init(const blsPublicKey *pubVec, size_t n)
+	{
+		if (n >= 0x80000000) return false;
+		size_t tblSize = 16;
+		while (tblSize < n * 2) tblSize *= 2;
+		// tbl[h] = (the index of the group) + 1 or 0 if empty
+		std::vector<uint32_t> tbl;
+		if (!resizeVec(tbl, tblSize) || !resizeVec(idxVec_, n) || !resizeVec(aggPubVec_, n)) return false;
+		for (size_t i = 0; i < n; i++) {
+			const void *p = msg_.getPtr(i);
+			const mclSize size = msg_.getSize(i);
+			const Gother& pub = *cast(&pubVec[i].v);
+			size_t h = size_t(hashBytes(p, size)) & (tblSize - 1);
+			for (;;) {
+				const uint32_t g = tbl[h];
+				if (g == 0) {
+					tbl[h] = uint32_t(n_ + 1);
+					idxVec_[n_] = uint32_t(i);
+					aggPubVec_[n_] = pub;
+					n_++;
+					break;
+				}
+				if (isEqual(idxVec_[g - 1], p, size)) {
+					aggPubVec_[g - 1] += pub;
+					break;
+				}
+				h = (h + 1) & (tblSize - 1);
+			}
+		}
+		return true;
+	}
+	size_t size() const { return n_; }
+	const void *getPtr(size_t j) const { return msg_.getPtr(idxVec_[j]); }
+	mclSize getSize(size_t j) const { return msg_.getSize(idxVec_[j]); }
+	const Gother& getPub(size_t j) const { return aggPubVec_[j]; }
+};
+
+/*
+	pairs of the groups of messages
+	swap
+	0 : (P, -sig)
+	j + 1 : (aggPub_j, H(msg_j)) for j = 0, ..., groupN - 1
+	not swap
+	j : (H(msg_j), aggPub_j) for j = 0, ..., groupN - 1
+*/
+template<class Group>
+struct GroupPairs {
+	const blsSignature *sig;
+	const Group& grp;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+#ifdef BLS_SWAP_G
+		if (i == 0) {
+			P = getBasePointAdjInv();
+			G2::neg(Q, *cast(&sig->v));
+			return true;
+		}
+		i--;
+		P = grp.getPub(i);
+		hashAndMapToGwithCache(Q, grp.getPtr(i), grp.getSize(i));
+#else
+		hashAndMapToGwithCache(P, grp.getPtr(i), grp.getSize(i));
+		Q = grp.getPub(i);
+#endif
+		return true;
+	}
+};
+
+template<class Group>
+int verifyGroups(const blsSignature *sig, const Group& grp)
+{
+	const GroupPairs<Group> pairs = { sig, grp };
+	GT e1;
+#ifdef BLS_SWAP_G
+	millerLoopPairs(e1, pairs, 0, grp.size() + 1);
+#else
+	millerLoopPairs(e1, pairs, 0, grp.size());
+	GT e2;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e2, -*cast(&sig->v), getQcoeff().data()));
+	e1 *= e2;
+#endif
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e1, e1));
+	return e1.isOne();
+}
+
+/*
+	e(P, sig) = prod_j e(sum_{msg_i = m_j} pub_i, H(m_j)) for the distinct messages m_j
+*/
+template<class Msg>
+int aggregateVerifyGroupByMessage(const blsSignature *sig, const blsPublicKey *pubVec, const Msg& msg, mclSize n)
+{
+	if (n == 0) return 0;
+	MessageGroup<Msg> grp(msg);
+	if (grp.init(pubVec, n)) return verifyGroups(sig, grp);
+	const Ungrouped<Msg> ungrouped = { msg, pubVec, n };
+	return verifyGroups(sig, ungrouped);
+}
+
+int blsAggregateVerifyGroupByMessage(const blsSignature *sig, const blsPublicKey *pubVec, const void *msgVec, mclSize msgSize, mclSize n)
+{
+	const PackedMsg msg = { (const char*)msgVec, msgSize };
+	return aggregateVerifyGroupByMessage(sig, pubVec, msg, n);
+}
+
+int blsAggregateVerifyGroupByMessagePtr(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, mclSize n)
+{
+	const PtrMsg msg = { msgPtrVec, msgSizeVec };
+	return aggregateVerifyGroupByMessage(sig, pubVec, msg, n);
+}
+
+int blsSetHashCacheSize(mclSize maxN)
+{
+#ifdef BLS_USE_HASH_CACHE
+	g_hashCache.setSize(maxN);
+	return 0;
+#else
+	(void)maxN;
+	return -1;
+#endif
+}
+
+void blsGetHashCacheStats(uint64_t *hitN, uint64_t *missN, mclSize *entryN)
+{
+#ifdef BLS_USE_HASH_CACHE
+	g_hashCache.getStats(hitN, missN, entryN);
+#else
+	if (hitN) *hitN = 0;
+	if (missN) *missN = 0;
+	if (entryN) *entryN = 0;
+#endif
+}
+
+void blsClearHashCache(void)
+{
+#ifdef BLS_USE_HASH_CACHE
+	g_hashCache.clear(true);
+#endif
+}
+
+int blsSetSha256Mode(int mode)
+{
+	if (mode & ~bls::sha256::getSupportedMode()) return -1;
+	bls::sha256::setMode(mode);
+	return 0;
+}
+
+int blsGetSha256Mode(void)
+{
+	return bls::sha256::getMode();
+}
+
+int blsGetSha256SupportedMode(void)
+{
+	return bls::sha256::getSupportedMode();
+}
+
+mclSize blsSha256(void *md, mclSize mdSize, const void *msg, mclSize msgSize)
+{
+	return bls::sha256::sha256(md, mdSize, msg, msgSize);
+}
+
+int blsGetStats(blsStats *stats)
+{
+#ifdef BLS_USE_STATS
+	bls::stats::get(stats);
+	return 0;
+#else
+	memset(stats, 0, sizeof(*stats));
+	return -1;
+#endif
+}
+
+void blsResetStats(void)
+{
+#ifdef BLS_USE_STATS
+	bls::stats::reset();
+#endif
+}
+
+mclSize blsGetStatsText(char *buf, mclSize maxBufSize)
+{
+#ifdef BLS_USE_STATS
+	return bls::stats::getText(buf, maxBufSize);
+#else
+	(void)buf;
+	(void)maxBufSize;
+	return 0;
+#endif
+}
+
+inline void getPublicKey(Gother& P, const blsPublicKeyAffine& a)
+{
+	P.x = *cast(&a.x);
+	P.y = *cast(&a.y);
+	P.z = 1;
+}
+
+int blsPublicKeyRegistryInit(blsPublicKeyRegistry *reg, blsPublicKeyAffine *keyVec, const blsPublicKey *pubVec, mclSize n)
+{
+	reg->keyVec = keyVec;
+	reg->n = 0;
+	for (mclSize i = 0; i < n; i++) {
+		Gother P = *cast(&pubVec[i].v);
+		if (P.isZero()) return -1;
+		bool b;
+		BLS_STATS_CALL(BLS_STATS_ORDER_CHECK, b = P.isValidOrder());
+		if (!b) return -1;
+		P.normalize();
+		*cast(&keyVec[i].x) = P.x;
+		*cast(&keyVec[i].y) = P.y;
+	}
+	reg->n = n;
+	return 0;
+}
+
+/*
+	the z coordinate of each key is one, so P += Q is a mixed addition
+*/
+int blsAggregatePublicKeyIdx(blsPublicKey *aggPub, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, mclSize n)
+{
+	Gother& P = *cast(&aggPub->v);
+	P.clear();
+	Gother Q;
+	for (mclSize i = 0; i < n; i++) {
+		const uint32_t idx = idxVec[i];
+		if (idx >= reg->n) return -1;
+		getPublicKey(Q, reg->keyVec[idx]);
+		P += Q;
+	}
+	return 0;
+}
+
+int blsFastAggregateVerifyIdx(const blsSignature *sig, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, mclSize n, const void *msg, mclSize msgSize)
+{
+	if (n == 0) return 0;
+	blsPublicKey aggPub;
+	if (blsAggregatePublicKeyIdx(&aggPub, reg, idxVec, n) != 0) return 0;
+	return blsVerify(sig, &aggPub, msg, msgSize);
+}
+
+/*
+	pairs of blsAggregateVerifyNoCheckIdx
+	swap
+	0 : (P, -sig)
+	i + 1 : (keyVec[idxVec[i]], H(msg_i)) for i = 0, ..., n - 1
+	not swap
+	i : (H(msg_i), keyVec[idxVec[i]]) for i = 0, ..., n - 1
+*/
+struct RegistryPairs {
+	const blsSignature *sig;
+	const blsPublicKeyRegistry *reg;
+	const uint32_t *idxVec;
+	const char *msgVec;
+	mclSize msgSize;
+	bool get(G1& P, G2& Q, size_t i) const
+	{
+#ifdef BLS_SWAP_G
+		if (i == 0) {
+			P = getBasePointAdjInv();
+			G2::neg(Q, *cast(&sig->v));
+			return true;
+		}
+		i--;
+		if (idxVec[i] >= reg->n) return false;
+		getPublicKey(P, reg->keyVec[idxVec[i]]);
+		hashAndMapToGwithCache(Q, &msgVec[i * msgSize], msgSize);
+#else
+		if (idxVec[i] >= reg->n) return false;
+		getPublicKey(Q, reg->keyVec[idxVec[i]]);
+		hashAndMapToGwithCache(P, &msgVec[i * msgSize], msgSize);
+#endif
+		return true;
+	}
+};
+
+int blsAggregateVerifyNoCheckIdx(const blsSignature *sig, const blsPublicKeyRegistry *reg, const uint32_t *idxVec, const void *msgVec, mclSize msgSize, mclSize n)
+{
+	if (n == 0) return 0;
+	const RegistryPairs pairs = { sig, reg, idxVec, (const char*)msgVec, msgSize };
+	GT e1;
+#ifdef BLS_SWAP_G
+	if (!millerLoopPairs(e1, pairs, 0, n + 1)) return 0;
+#else
+	if (!millerLoopPairs(e1, pairs, 0, n)) return 0;
+	GT e2;
+	BLS_STATS_CALL(BLS_STATS_MILLER_LOOP, BN::precomputedMillerLoop(e2, -*cast(&sig->v), getQcoeff().data()));
+	e1 *= e2;
+#endif
+	BLS_STATS_CALL(BLS_STATS_FINAL_EXP, BN::finalExp(e1, e1));
+	return e1.isOne();
+}
+
+inline size_t popcnt64(uint64_t x)
 {
-#ifdef BLS_ETH
-	if (g_curveType != MCL_BLS12_381) return -1;
-	uint8_t msg[96];
-	blsHashWithDomainToFp2(msg, hashWithDomain);
-	return blsSignHash(sig, sec, msg, sizeof(msg));
+#ifdef __GNUC__
+	return __builtin_popcountll(x);
 #else
-	(void)sig;
-	(void)sec;
-	(void)hashWithDomain;
-	return -1;
+	size_t c = 0;
+	for (; x; x &= x - 1) c++;
+	return c;
 #endif
 }
 
-int blsVerifyHashWithDomain(const blsSignature *sig, const blsPublicKey *pub, const uint8_t hashWithDomain[40])
+// x != 0
+inline size_t ctz64(uint64_t x)
 {
-#ifdef BLS_ETH
-	if (g_curveType != MCL_BLS12_381) return 0;
-	uint8_t msg[96];
-	blsHashWithDomainToFp2(msg, hashWithDomain);
-	return blsVerifyHash(sig, pub, msg, sizeof(msg));
+#ifdef __GNUC__
+	return __builtin_ctzll(x);
 #else
-	(void)sig;
-	(void)pub;
-	(void)hashWithDomain;
-	return 0;
+	size_t i = 0;
+	for (; (x & 1) == 0; x >>= 1) i++;
+	return i;
 #endif
 }
 
-int blsVerifyAggregatedHashWithDomain(const blsSignature *aggSig, const blsPublicKey *pubVec, const unsigned char hashWithDomain[][40], mclSize n)
+// bits [w * 64, w * 64 + 64) of bitVec[0, (n + 7) / 8) ; bit i is (bitVec[i / 8] >> (i % 8)) & 1
+inline uint64_t loadWord(const uint8_t *bitVec, size_t w, size_t n)
 {
-#ifdef BLS_ETH
-	if (g_curveType != MCL_BLS12_381) return 0;
-	if (n == 0) return 0;
-	GT e1;
-	const size_t N = 16;
-	G1 g1Vec[N];
-	G2 g2Vec[N];
+	const size_t byteN = (n + 7) / 8;
+	uint64_t x = 0;
+	for (size_t i = 0; i < 8 && w * 8 + i < byteN; i++) {
+		x |= uint64_t(bitVec[w * 8 + i]) << (i * 8);
+	}
+	return x;
+}
+
+// clear the bits of the w-th word at or above n
+inline uint64_t maskWord(uint64_t x, size_t w, size_t n)
+{
+	const size_t r = n - w * 64;
+	return r < 64 ? x & ((uint64_t(1) << r) - 1) : x;
+}
 
-	size_t start = 1; // 1 if first else 0
+/*
+	out = sum of pubVec[begin, end)
+	nodeVec[n + i] = pubVec[i] and nodeVec[i] = nodeVec[2i] + nodeVec[2i + 1]
+*/
+inline void sumRange(Gother& out, const blsPublicKey *nodeVec, size_t n, size_t begin, size_t end)
+{
+	out.clear();
+	for (begin += n, end += n; begin < end; begin /= 2, end /= 2) {
+		if (begin & 1) out += *cast(&nodeVec[begin++].v);
+		if (end & 1) out += *cast(&nodeVec[--end].v);
+	}
+}
 
-	g1Vec[0] = getBasePointAdjInv();
-	G2::neg(g2Vec[0], *cast(&aggSig->v));
-	while (n > 0) {
-		size_t m = N - start;
-		if (n < m) m = n;
-		for (size_t i = 0; i < m; i++) {
-			g1Vec[i + start] = *cast(&pubVec[i].v);
-			uint8_t buf[96];
-			blsHashWithDomainToFp2(buf, hashWithDomain[i]);
-			if (!toG(g2Vec[i + start], buf, sizeof(buf))) return 0;
+/*
+	out = sum of pubVec[i] such that bit i of getWord(w) (i = w * 64 + bit) is one
+	each run of consecutive ones is summed by sumRange
+	zero words and full words inside a run are skipped without scanning the bits
+*/
+template<class GetWord>
+void sumRuns(Gother& out, const blsPublicKey *nodeVec, size_t n, const GetWord& getWord)
+{
+	out.clear();
+	Gother t;
+	const size_t wordN = (n + 63) / 64;
+	bool inRun = false;
+	size_t begin = 0;
+	for (size_t w = 0; w < wordN; w++) {
+		uint64_t x = getWord(w);
+		const size_t base = w * 64;
+		if (inRun) {
+			if (x == ~uint64_t(0)) continue;
+			const size_t end = ctz64(~x);
+			sumRange(t, nodeVec, n, begin, base + end);
+			out += t;
+			inRun = false;
+			x &= ~uint64_t(0) << end;
 		}
-		if (start) {
-			millerLoopVec(e1, g1Vec, g2Vec, m + start);
-			start = 0;
-		} else {
-			GT e2;
-			millerLoopVec(e2, g1Vec, g2Vec, m);
-			e1 *= e2;
+		while (x) {
+			const size_t b = ctz64(x);
+			const uint64_t y = x | ((uint64_t(1) << b) - 1);
+			if (y == ~uint64_t(0)) {
+				begin = base + b;
+				inRun = true;
+				break;
+			}
+			const size_t end = ctz64(~y);
+			sumRange(t, nodeVec, n, base + b, base + end);
+			out += t;
+			x &= ~uint64_t(0) << end;
 		}
-		pubVec += m;
-		hashWithDomain += m;
-		n -= m;
 	}
-	BN::finalExp(e1, e1);
-	return e1.isOne();
-#else
-	(void)aggSig;
-	(void)pubVec;
-	(void)hashWithDomain;
-	(void)n;
+	if (inRun) {
+		sumRange(t, nodeVec, n, begin, n);
+		out += t;
+	}
+}
+
+struct BitIs {
+	const uint8_t *bitVec;
+	size_t n;
+	bool v;
+	uint64_t operator()(size_t w) const
+	{
+		const uint64_t x = loadWord(bitVec, w, n);
+		return maskWord(v ? x : ~x, w, n);
+	}
+};
+
+// the bit is changed from !v to v
+struct BitChangedTo {
+	const uint8_t *prev;
+	const uint8_t *cur;
+	size_t n;
+	bool v;
+	uint64_t operator()(size_t w) const
+	{
+		const uint64_t x = loadWord(cur, w, n);
+		const uint64_t y = loadWord(prev, w, n);
+		return maskWord(v ? x & ~y : ~x & y, w, n);
+	}
+};
+
+int blsPublicKeyAggregatorInit(blsPublicKeyAggregator *ag, blsPublicKey *nodeVec, uint8_t *bitVec, const blsPublicKey *pubVec, mclSize n)
+{
+	if (n == 0) return -1;
+	for (mclSize i = 0; i < n; i++) {
+		nodeVec[n + i] = pubVec[i];
+	}
+	for (mclSize i = n - 1; i > 0; i--) {
+		Gother::add(*cast(&nodeVec[i].v), *cast(&nodeVec[i * 2].v), *cast(&nodeVec[i * 2 + 1].v));
+	}
+	memset(&nodeVec[0], 0, sizeof(nodeVec[0]));
+	ag->nodeVec = nodeVec;
+	ag->bitVec = bitVec;
+	memset(&ag->agg, 0, sizeof(ag->agg));
+	ag->n = n;
+	ag->hasPrev = 0;
+	return 0;
+}
+
+int blsPublicKeyAggregatorGet(blsPublicKey *aggPub, blsPublicKeyAggregator *ag, const uint8_t *bitfield)
+{
+	const size_t n = ag->n;
+	size_t k = 0; // the number of participants
+	size_t c = 0; // the number of changed bits
+	for (size_t w = 0; w < (n + 63) / 64; w++) {
+		const uint64_t x = maskWord(loadWord(bitfield, w, n), w, n);
+		k += popcnt64(x);
+		if (ag->hasPrev) c += popcnt64(x ^ maskWord(loadWord(ag->bitVec, w, n), w, n));
+	}
+	Gother& out = *cast(&ag->agg.v);
+	Gother t;
+	if (ag->hasPrev && c <= k && c <= n - k) {
+		const BitChangedTo added = { ag->bitVec, bitfield, n, true };
+		const BitChangedTo removed = { ag->bitVec, bitfield, n, false };
+		sumRuns(t, ag->nodeVec, n, added);
+		out += t;
+		sumRuns(t, ag->nodeVec, n, removed);
+		out -= t;
+	} else if (k <= n - k) {
+		const BitIs participant = { bitfield, n, true };
+		sumRuns(out, ag->nodeVec, n, participant);
+	} else {
+		// nodeVec[1] is the sum of all pubVec
+		const BitIs absentee = { bitfield, n, false };
+		sumRuns(t, ag->nodeVec, n, absentee);
+		Gother::sub(out, *cast(&ag->nodeVec[1].v), t);
+	}
+	memcpy(ag->bitVec, bitfield, (n + 7) / 8);
+	ag->hasPrev = 1;
+	*aggPub = ag->agg;
 	return 0;
-#endif
 }
 
 int blsVerifyPairing(const blsSignature *X, const blsSignature *Y, const blsPublicKey *pub)
@@ -1025,15 +2767,11 @@ void blsDHKeyExchange(blsPublicKey *out, const blsSecretKey *sec, const blsPubli
 
 void normalizePubVec(blsPublicKey *pubVec, mclSize n)
 {
-	for (size_t i = 0; i < n; i++) {
-		cast(&pubVec[i].v)->normalize();
-	}
+	normalizeVec(cast(&pubVec[0].v), n);
 }
 
-#define CYBOZU_DONT_USE_OPENSSL
-#include <cybozu/sha2.hpp>
 #include <cybozu/endian.hpp>
-void hashPublicKey(cybozu::Sha256& h, const blsPublicKey *pubVec, mclSize n)
+void hashPublicKey(bls::sha256::Sha256& h, const blsPublicKey *pubVec, mclSize n)
 {
 	for (size_t i = 0; i < n; i++) {
 		const Gother& v = *cast(&pubVec[i].v);
@@ -1047,27 +2785,42 @@ void hashPublicKey(cybozu::Sha256& h, const blsPublicKey *pubVec, mclSize n)
 	}
 }
 
-void hashToFr(Fr *out, const cybozu::Sha256& h0, mclSize begin, mclSize n)
+/*
+	out[i] = SHA-256(h0 || 4-byte little endian(begin + i)) for i < n
+	the hashes are computed by the multi-buffer implementation
+*/
+void hashToFr(Fr *out, const bls::sha256::Sha256& h0, mclSize begin, mclSize n)
 {
-	for (size_t i = 0; i < n; i++) {
-		cybozu::Sha256 h = h0;
-		char md[32];
-		char buf[4];
-		cybozu::Set32bitAsLE(buf, uint32_t(begin + i));
-		h.digest(md, sizeof(md), buf, sizeof(buf));
-		out[i].setArrayMask(md, sizeof(md));
+	const size_t N = 32;
+	char buf[N * 4];
+	char md[N * bls::sha256::mdSize];
+	while (n > 0) {
+		const size_t m = n < N ? n : N;
+		for (size_t i = 0; i < m; i++) {
+			cybozu::Set32bitAsLE(&buf[i * 4], uint32_t(begin + i));
+		}
+		h0.digestVec(md, buf, 4, m);
+		for (size_t i = 0; i < m; i++) {
+			out[i].setArrayMask(&md[i * bls::sha256::mdSize], bls::sha256::mdSize);
+		}
+		out += m;
+		begin += m;
+		n -= m;
 	}
 }
 
+/*
+	out = sum_{i in [begin, end)} vec[i] t_i by chunks of mulVec
+*/
 template<class T, class U>
-void aggregate(T& out, const cybozu::Sha256& h0, const U *vec, mclSize n)
+void aggregateByChunk(T& out, const bls::sha256::Sha256& h0, const U *vec, size_t begin, size_t end)
 {
 	out.clear();
 	const size_t N = 16;
 	Fr t[N];
-	size_t pos = 0;
-	while (pos < n) {
-		size_t m = n - pos;
+	size_t pos = begin;
+	while (pos < end) {
+		size_t m = end - pos;
 		if (m > N) m = N;
 		hashToFr(t, h0, pos, m);
 		T sub;
@@ -1077,26 +2830,453 @@ void aggregate(T& out, const cybozu::Sha256& h0, const U *vec, mclSize n)
 	}
 }
 
+/*
+	z = sum_{i < n} xVec[i] y_i by the bucket method (Pippenger)
+	y_i = yVec[i * yn, (i + 1) * yn) as little endian
+	buckets[0, 2^c - 1) is a work space
+	cost : (bitSize / c) (n + 2^(c + 1) + c) additions
+*/
+template<class E>
+void mulVecBucket(E& z, const E *xVec, const mcl::fp::Unit *yVec, size_t yn, size_t n, size_t c, E *buckets)
+{
+	const size_t bucketN = (size_t(1) << c) - 1;
+	const size_t winN = (Fr::getBitSize() + c - 1) / c;
+	z.clear();
+	for (size_t w = winN; w > 0;) {
+		w--;
+		for (size_t j = 0; j < c; j++) {
+			E::dbl(z, z);
+		}
+		for (size_t j = 0; j < bucketN; j++) {
+			buckets[j].clear();
+		}
+		for (size_t i = 0; i < n; i++) {
+			const size_t k = getWindow(&yVec[i * yn], yn, w * c, c);
+			if (k) buckets[k - 1] += xVec[i];
+		}
+		// sum_j (j + 1) buckets[j]
+		E sum, acc;
+		sum.clear();
+		acc.clear();
+		for (size_t j = bucketN; j > 0;) {
+			j--;
+			sum += buckets[j];
+			acc += sum;
+		}
+		z += acc;
+	}
+}
+
+// the bucket method is faster than mulVec if n >= minBucketN
+const size_t minBucketN = 128;
+
+inline size_t getBucketBitSize(size_t n)
+{
+	size_t c = 4;
+	while (c < 13 && (size_t(1) << (c + 3)) < n) c++;
+	return c;
+}
+
+/*
+	out = sum_{i in [begin, end)} vec[i] t_i where t_i = hashToFr(h0, i)
+	use the bucket method for large n and fall back to aggregateByChunk if it fails to allocate memory
+*/
+template<class T, class U>
+void aggregate(T& out, const bls::sha256::Sha256& h0, const U *vec, size_t begin, size_t end)
+{
+	const size_t n = end - begin;
+	if (n >= minBucketN) {
+		const size_t c = getBucketBitSize(n);
+		const size_t yn = sizeof(Fr) / sizeof(mcl::fp::Unit);
+		std::vector<mcl::fp::Unit> yVec;
+		std::vector<T> buckets;
+		if (resizeVec(yVec, yn * n) && resizeVec(buckets, (size_t(1) << c) - 1)) {
+			const size_t N = 32;
+			Fr t[N];
+			for (size_t i = 0; i < n; i++) {
+				if (i % N == 0) hashToFr(t, h0, begin + i, n - i < N ? n - i : N);
+				getUnit(&yVec[i * yn], yn, t[i % N]);
+			}
+			mulVecBucket(out, cast(&vec[begin].v), &yVec[0], yn, n, c, &buckets[0]);
+			return;
+		}
+	}
+	aggregateByChunk(out, h0, vec, begin, end);
+}
+
+#ifdef BLS_USE_THREAD
+template<class T, class U>
+struct AggregateTask {
+	const bls::sha256::Sha256& h0;
+	const U *vec;
+	T *outVec;
+	AggregateTask(const bls::sha256::Sha256& h, const U *v, T *out)
+		: h0(h), vec(v), outVec(out)
+	{
+	}
+	void operator()(size_t begin, size_t end, size_t idx)
+	{
+		aggregate(outVec[idx], h0, vec, begin, end);
+	}
+};
+#endif
+
+/*
+	out = sum_{i < n} vec[i] t_i
+	each thread hashes t_i and computes the sum for a disjoint range
+*/
+template<class T, class U>
+void aggregateMT(T& out, const bls::sha256::Sha256& h0, const U *vec, size_t n, size_t threadN)
+{
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		std::vector<T> outVec(threadN);
+		AggregateTask<T, U> task(h0, vec, &outVec[0]);
+		parallelFor(task, n, threadN);
+		out = outVec[0];
+		for (size_t i = 1; i < threadN; i++) {
+			out += outVec[i];
+		}
+		return;
+	}
+#else
+	(void)threadN;
+#endif
+	aggregate(out, h0, vec, 0, n);
+}
+
 // aggSig = sum sigVec[i] t_i where (t_1, ..., t_n) = H({pubVec})
-void blsMultiAggregateSignature(blsSignature *aggSig, blsSignature *sigVec, blsPublicKey *pubVec, mclSize n)
+void blsMultiAggregateSignatureMT(blsSignature *aggSig, blsSignature *sigVec, blsPublicKey *pubVec, mclSize n, mclSize threadN)
 {
 	normalizePubVec(pubVec, n);
-	cybozu::Sha256 h0;
+	bls::sha256::Sha256 h0;
 	hashPublicKey(h0, pubVec, n);
 	G out;
-	aggregate(out, h0, sigVec, n);
+	aggregateMT(out, h0, sigVec, n, threadN);
 	*cast(&aggSig->v) = out;
 }
+
+void blsMultiAggregateSignature(blsSignature *aggSig, blsSignature *sigVec, blsPublicKey *pubVec, mclSize n)
+{
+	blsMultiAggregateSignatureMT(aggSig, sigVec, pubVec, n, 1);
+}
+
 // aggPub = sum pubVec[i] t_i where (t_1, ..., t_n) = H({pubVec})
-void blsMultiAggregatePublicKey(blsPublicKey *aggPub, blsPublicKey *pubVec, mclSize n)
+void blsMultiAggregatePublicKeyMT(blsPublicKey *aggPub, blsPublicKey *pubVec, mclSize n, mclSize threadN)
 {
 	normalizePubVec(pubVec, n);
-	cybozu::Sha256 h0;
+	bls::sha256::Sha256 h0;
 	hashPublicKey(h0, pubVec, n);
 	Gother out;
-	aggregate(out, h0, pubVec, n);
+	aggregateMT(out, h0, pubVec, n, threadN);
 	*cast(&aggPub->v) = out;
 }
 
+void blsMultiAggregatePublicKey(blsPublicKey *aggPub, blsPublicKey *pubVec, mclSize n)
+{
+	blsMultiAggregatePublicKeyMT(aggPub, pubVec, n, 1);
+}
+
+/*
+	out = sum_{i in [begin, end)} xVec[i] yVec[i]
+	use the bucket method for large n and fall back to mulVec if it fails to allocate memory
+*/
+template<class T>
+void mulVecLarge(T& out, const T *xVec, const Fr *yVec, size_t begin, size_t end)
+{
+	const size_t n = end - begin;
+	if (n >= minBucketN) {
+		const size_t c = getBucketBitSize(n);
+		const size_t yn = sizeof(Fr) / sizeof(mcl::fp::Unit);
+		std::vector<mcl::fp::Unit> y;
+		std::vector<T> buckets;
+		if (resizeVec(y, yn * n) && resizeVec(buckets, (size_t(1) << c) - 1)) {
+			for (size_t i = 0; i < n; i++) {
+				getUnit(&y[i * yn], yn, yVec[begin + i]);
+			}
+			mulVecBucket(out, &xVec[begin], &y[0], yn, n, c, &buckets[0]);
+			return;
+		}
+	}
+	T::mulVec(out, &xVec[begin], &yVec[begin], n);
+}
+
+#ifdef BLS_USE_THREAD
+template<class T>
+struct MulVecTask {
+	const T *xVec;
+	const Fr *yVec;
+	T *outVec;
+	MulVecTask(const T *x, const Fr *y, T *out)
+		: xVec(x), yVec(y), outVec(out)
+	{
+	}
+	void operator()(size_t begin, size_t end, size_t idx)
+	{
+		mulVecLarge(outVec[idx], xVec, yVec, begin, end);
+	}
+};
+#endif
+
+// out = sum_{i < n} xVec[i] yVec[i] on threadN threads
+template<class T>
+void mulVecMT(T& out, const T *xVec, const Fr *yVec, size_t n, size_t threadN)
+{
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		std::vector<T> outVec(threadN);
+		MulVecTask<T> task(xVec, yVec, &outVec[0]);
+		parallelFor(task, n, threadN);
+		out = outVec[0];
+		for (size_t i = 1; i < threadN; i++) {
+			out += outVec[i];
+		}
+		return;
+	}
+#else
+	(void)threadN;
+#endif
+	mulVecLarge(out, xVec, yVec, 0, n);
+}
+
+// out = sum_{i < n} xVec[i] yVec[i] for secret keys
+inline void mulVecMT(Fr& out, const Fr *xVec, const Fr *yVec, size_t n, size_t)
+{
+	Fr t = 0;
+	for (size_t i = 0; i < n; i++) {
+		t += xVec[i] * yVec[i];
+	}
+	out = t;
+}
+
+// b[i] = S_i prod_{j != i} (S_j - S_i) for i in [begin, end)
+inline void getLagrangeDenominator(Fr *b, const Fr *S, size_t n, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++) {
+		Fr t = S[i];
+		for (size_t j = 0; j < n; j++) {
+			if (j == i) continue;
+			t *= S[j] - S[i];
+		}
+		b[i] = t;
+	}
+}
+
+#ifdef BLS_USE_THREAD
+struct LagrangeDenominatorTask {
+	Fr *b;
+	const Fr *S;
+	size_t n;
+	LagrangeDenominatorTask(Fr *out, const Fr *idVec, size_t idN)
+		: b(out), S(idVec), n(idN)
+	{
+	}
+	void operator()(size_t begin, size_t end, size_t)
+	{
+		getLagrangeDenominator(b, S, n, begin, end);
+	}
+};
+#endif
+
+/*
+	c_i = a / b_i where a = prod_j S_j and b_i = S_i prod_{j != i} (S_j - S_i)
+	b_i are computed on threadN threads and inverted at once by Montgomery's trick
+*/
+int blsRecoveryPlanInitMT(blsRecoveryPlan *plan, mclBnFr *coeffVec, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	if (n == 0) return -1;
+	const Fr *S = cast(&idVec[0].v);
+	Fr *c = cast(&coeffVec[0]);
+	std::vector<Fr> tbl; // tbl[i] = b_0 ... b_{i-1}
+	if (!resizeVec(tbl, n)) return -1;
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		LagrangeDenominatorTask task(c, S, n);
+		parallelFor(task, n, threadN);
+	} else {
+		getLagrangeDenominator(c, S, n, 0, n);
+	}
+#else
+	(void)threadN;
+	getLagrangeDenominator(c, S, n, 0, n);
+#endif
+	Fr a = 1, acc = 1;
+	for (size_t i = 0; i < n; i++) {
+		a *= S[i];
+		tbl[i] = acc;
+		acc *= c[i];
+	}
+	// acc = 0 iff some b_i = 0 iff a zero id or the same ids
+	if (acc.isZero()) return -1;
+	Fr::inv(acc, acc);
+	acc *= a;
+	for (size_t i = n; i > 0;) {
+		i--;
+		const Fr b = c[i];
+		c[i] = acc * tbl[i];
+		acc *= b;
+	}
+	plan->coeffVec = coeffVec;
+	plan->n = n;
+	return 0;
+}
+
+int blsRecoveryPlanInit(blsRecoveryPlan *plan, mclBnFr *coeffVec, const blsId *idVec, mclSize n)
+{
+	return blsRecoveryPlanInitMT(plan, coeffVec, idVec, n, 1);
+}
+
+int blsSecretKeyRecoverByPlan(blsSecretKey *sec, const blsSecretKey *secVec, const blsRecoveryPlan *plan)
+{
+	mulVecMT(*cast(&sec->v), cast(&secVec[0].v), cast(&plan->coeffVec[0]), plan->n, 1);
+	return 0;
+}
+
+int blsPublicKeyRecoverByPlanMT(blsPublicKey *pub, const blsPublicKey *pubVec, const blsRecoveryPlan *plan, mclSize threadN)
+{
+	mulVecMT(*cast(&pub->v), cast(&pubVec[0].v), cast(&plan->coeffVec[0]), plan->n, threadN);
+	return 0;
+}
+
+int blsSignatureRecoverByPlanMT(blsSignature *sig, const blsSignature *sigVec, const blsRecoveryPlan *plan, mclSize threadN)
+{
+	mulVecMT(*cast(&sig->v), cast(&sigVec[0].v), cast(&plan->coeffVec[0]), plan->n, threadN);
+	return 0;
+}
+
+int blsPublicKeyRecoverByPlan(blsPublicKey *pub, const blsPublicKey *pubVec, const blsRecoveryPlan *plan)
+{
+	return blsPublicKeyRecoverByPlanMT(pub, pubVec, plan, 1);
+}
+
+int blsSignatureRecoverByPlan(blsSignature *sig, const blsSignature *sigVec, const blsRecoveryPlan *plan)
+{
+	return blsSignatureRecoverByPlanMT(sig, sigVec, plan, 1);
+}
+
+/*
+	recover with a temporary plan
+	fall back to LagrangeInterpolation if it fails to allocate memory
+*/
+template<class T>
+int recoverMT(T& out, const T *vec, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	if (n == 0) return -1;
+	std::vector<mclBnFr> coeffVec;
+	if (!resizeVec(coeffVec, n)) {
+		bool b;
+		mcl::LagrangeInterpolation(&b, out, cast(&idVec->v), vec, n);
+		return b ? 0 : -1;
+	}
+	blsRecoveryPlan plan;
+	int ret = blsRecoveryPlanInitMT(&plan, &coeffVec[0], idVec, n, threadN);
+	if (ret == 0) mulVecMT(out, vec, cast(&coeffVec[0]), n, threadN);
+	return ret;
+}
+
+int blsSecretKeyRecoverMT(blsSecretKey *sec, const blsSecretKey *secVec, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	return recoverMT(*cast(&sec->v), cast(&secVec->v), idVec, n, threadN);
+}
+
+int blsPublicKeyRecoverMT(blsPublicKey *pub, const blsPublicKey *pubVec, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	return recoverMT(*cast(&pub->v), cast(&pubVec->v), idVec, n, threadN);
+}
+
+int blsSignatureRecoverMT(blsSignature *sig, const blsSignature *sigVec, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	return recoverMT(*cast(&sig->v), cast(&sigVec->v), idVec, n, threadN);
+}
+
+// out[i] = sum_{j < k} c[j] x[i]^j for i in [begin, end) by Horner's method
+inline bool evaluatePolynomialVec(Fr *out, const Fr *c, size_t k, const Fr *x, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++) {
+		Fr t = c[k - 1];
+		for (size_t j = k - 1; j > 0;) {
+			j--;
+			t *= x[i];
+			t += c[j];
+		}
+		out[i] = t;
+	}
+	return true;
+}
+
+/*
+	out[i] = sum_{j < k} c[j] x[i]^j for i in [begin, end)
+	each out[i] is a multi-scalar multiplication by the powers of x[i]
+	return false if it fails to allocate memory
+*/
+template<class T>
+bool evaluatePolynomialVec(T *out, const T *c, size_t k, const Fr *x, size_t begin, size_t end)
+{
+	std::vector<Fr> powVec;
+	if (!resizeVec(powVec, k)) return false;
+	for (size_t i = begin; i < end; i++) {
+		powVec[0] = 1;
+		for (size_t j = 1; j < k; j++) {
+			powVec[j] = powVec[j - 1] * x[i];
+		}
+		mulVecLarge(out[i], c, &powVec[0], 0, k);
+	}
+	return true;
+}
+
+#ifdef BLS_USE_THREAD
+template<class T>
+struct ShareTask {
+	T *out;
+	const T *c;
+	size_t k;
+	const Fr *x;
+	int *okVec;
+	ShareTask(T *outVec, const T *cVec, size_t cN, const Fr *xVec, int *ok)
+		: out(outVec), c(cVec), k(cN), x(xVec), okVec(ok)
+	{
+	}
+	void operator()(size_t begin, size_t end, size_t idx)
+	{
+		okVec[idx] = evaluatePolynomialVec(out, c, k, x, begin, end);
+	}
+};
+#endif
+
+// out[i] = sum_{j < k} c[j] x[i]^j for i < n on threadN threads
+template<class T>
+int shareVec(T *out, const T *c, size_t k, const Fr *x, size_t n, size_t threadN)
+{
+	if (k == 0) return -1;
+#ifdef BLS_USE_THREAD
+	threadN = getThreadN(threadN, n);
+	if (threadN > 1) {
+		std::vector<int> okVec(threadN);
+		ShareTask<T> task(out, c, k, x, &okVec[0]);
+		parallelFor(task, n, threadN);
+		for (size_t i = 0; i < threadN; i++) {
+			if (!okVec[i]) return -1;
+		}
+		return 0;
+	}
+#else
+	(void)threadN;
+#endif
+	return evaluatePolynomialVec(out, c, k, x, 0, n) ? 0 : -1;
+}
+
+int blsSecretKeyShareVec(blsSecretKey *secVec, const blsSecretKey *msk, mclSize k, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	return shareVec(cast(&secVec->v), cast(&msk->v), k, cast(&idVec->v), n, threadN);
+}
+
+int blsPublicKeyShareVec(blsPublicKey *pubVec, const blsPublicKey *mpk, mclSize k, const blsId *idVec, mclSize n, mclSize threadN)
+{
+	return shareVec(cast(&pubVec->v), cast(&mpk->v), k, cast(&idVec->v), n, threadN);
+}
+
 #endif
 
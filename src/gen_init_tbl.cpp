@@ -0,0 +1,125 @@
+/*
+	generate the tables for blsInit of the libraries built with the same BLS_SWAP_G and BLS_ETH
+	gen_init_tbl.exe <output file>
+	see loadInitTbl in bls_c_impl.hpp
+*/
+#undef BLS_USE_INIT_TBL
+#undef BLS_MINIMUM_API
+#ifndef MCLBN_FP_UNIT_SIZE
+	#if defined(MCL_MAX_BIT_SIZE) && MCL_MAX_BIT_SIZE <= 384
+		#define MCLBN_FP_UNIT_SIZE 6
+	#else
+		#define MCLBN_FP_UNIT_SIZE 8
+	#endif
+#endif
+#include "bls_c_impl.hpp"
+#include <stdio.h>
+#include <stdarg.h>
+#include <string>
+#include <vector>
+
+#if MCL_SIZEOF_UNIT != 8
+	#error "gen_init_tbl supports only 64-bit Unit"
+#endif
+
+void putFp(std::vector<uint64_t>& v, const Fp *x, size_t n, size_t fpN)
+{
+	for (size_t i = 0; i < n; i++) {
+		const mcl::fp::Unit *p = x[i].getUnit();
+		for (size_t j = 0; j < fpN; j++) {
+			v.push_back(p[j]);
+		}
+	}
+}
+
+void putPoint(std::vector<uint64_t>& v, const Gother& P, size_t fpN)
+{
+	Gother Q;
+	Gother::normalize(Q, P);
+	putFp(v, getFp0(Q.x), otherFpN, fpN);
+	putFp(v, getFp0(Q.y), otherFpN, fpN);
+}
+
+void appendf(std::string& s, const char *format, ...)
+{
+	char buf[1024];
+	va_list args;
+	va_start(args, format);
+	vsnprintf(buf, sizeof(buf), format, args);
+	va_end(args);
+	s += buf;
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 2) {
+		fprintf(stderr, "gen_init_tbl.exe <output file>\n");
+		return 1;
+	}
+	/*
+		BLS12_381 is the last because blsInit of it changes the global mode of mapTo
+	*/
+	const struct {
+		int curve;
+		const char *name;
+	} curveTbl[] = {
+		{ MCL_BN254, "BN254" },
+		{ MCL_BN381_1, "BN381_1" },
+		{ MCL_BN462, "BN462" },
+		{ MCL_BLS12_381, "BLS12_381" },
+	};
+	std::string s, entry;
+	appendf(s, "// generated by gen_init_tbl ; do not edit\n");
+	appendf(s, "#define BLS_INIT_TBL_MODE %d\n", BLS_INIT_TBL_BUILD_MODE);
+	appendf(s, "static const int initTblMclVersion = 0x%x;\n", mclBn_getVersion());
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(curveTbl); i++) {
+		const int curve = curveTbl[i].curve;
+		const char *name = curveTbl[i].name;
+		if (blsInit(curve, MCLBN_COMPILED_TIME_VAR) != 0) {
+			fprintf(stderr, "skip %s\n", name);
+			continue;
+		}
+		const size_t fpN = Fp::getUnitSize();
+		std::vector<uint64_t> v;
+#ifdef BLS_SWAP_G
+		const size_t qcoeffN = 0;
+		putPoint(v, getBasePoint(), fpN);
+		putPoint(v, getBasePointAdjInv(), fpN);
+#else
+		const size_t qcoeffN = g_Qcoeff.size();
+		putPoint(v, getBasePoint(), fpN);
+		for (size_t j = 0; j < qcoeffN; j++) {
+			putFp(v, g_Qcoeff[j].getFp0(), 6, fpN);
+		}
+#endif
+		for (size_t j = 0; j < g_baseWinN * baseD; j++) {
+			putPoint(v, g_baseTbl[j], fpN);
+		}
+		appendf(s, "static const uint64_t initTbl%s[] = {\n", name);
+		for (size_t j = 0; j < v.size(); j++) {
+			appendf(s, "%s0x%016llxull,%s", j % 4 == 0 ? "\t" : "", (unsigned long long)v[j], j % 4 == 3 || j + 1 == v.size() ? "\n" : "");
+		}
+		appendf(s, "};\n");
+		appendf(entry, "\t{ MCL_%s, %d, %d, %d, initTbl%s },\n", name, (int)fpN, (int)qcoeffN, (int)g_baseWinN, name);
+		printf("%s fpN=%d qcoeffN=%d baseWinN=%d\n", name, (int)fpN, (int)qcoeffN, (int)g_baseWinN);
+	}
+	if (entry.empty()) {
+		fprintf(stderr, "no curve\n");
+		return 1;
+	}
+	appendf(s, "static const InitTbl initTblVec[] = {\n");
+	s += entry;
+	appendf(s, "};\n");
+	FILE *fp = fopen(argv[1], "w");
+	if (fp == 0) {
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 1;
+	}
+	const bool ok = fwrite(s.c_str(), 1, s.size(), fp) == s.size();
+	if (fclose(fp) != 0 || !ok) {
+		fprintf(stderr, "can't write %s\n", argv[1]);
+		remove(argv[1]);
+		return 1;
+	}
+	return 0;
+}
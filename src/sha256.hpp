@@ -0,0 +1,407 @@
+#pragma once
+/**
+	@file
+	@brief SHA-256 with runtime dispatch to SHA-NI and 8-lane AVX2
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+	@note define BLS_SHA256_DONT_USE_X86 to use only the portable implementation
+*/
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(BLS_SHA256_DONT_USE_X86) && (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__)) \
+	&& !defined(__EMSCRIPTEN__) && !defined(__wasm__)
+	#define BLS_SHA256_USE_X86
+	#include <immintrin.h>
+	#include <cpuid.h>
+#endif
+
+#if !defined(BLS_DONT_USE_THREAD) && (__cplusplus >= 201103L || (defined(_MSC_VER) && _MSC_VER >= 1900))
+	#define BLS_SHA256_USE_ATOMIC
+	#include <atomic>
+#endif
+
+namespace bls { namespace sha256 {
+
+enum {
+	SHA_NI = 1, // single message by Intel SHA extensions
+	AVX2 = 2 // 8 messages at once by AVX2
+};
+
+const uint32_t K[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const uint32_t H0[8] = {
+	0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+const size_t blockSize = 64;
+const size_t mdSize = 32;
+// the number of messages processed by compressX8
+const size_t laneN = 8;
+
+inline uint32_t rot(uint32_t x, int s) { return (x >> s) | (x << (32 - s)); }
+
+inline uint32_t get32bitAsBE(const uint8_t *p)
+{
+	return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+}
+
+inline void set32bitAsBE(uint8_t *p, uint32_t x)
+{
+	p[0] = uint8_t(x >> 24);
+	p[1] = uint8_t(x >> 16);
+	p[2] = uint8_t(x >> 8);
+	p[3] = uint8_t(x);
+}
+
+// update h by blockN blocks of 64 bytes
+inline void compressPortable(uint32_t h[8], const uint8_t *block, size_t blockN)
+{
+	for (size_t i = 0; i < blockN; i++) {
+		uint32_t w[64];
+		for (int t = 0; t < 16; t++) {
+			w[t] = get32bitAsBE(block + t * 4);
+		}
+		for (int t = 16; t < 64; t++) {
+			const uint32_t s0 = rot(w[t - 15], 7) ^ rot(w[t - 15], 18) ^ (w[t - 15] >> 3);
+			const uint32_t s1 = rot(w[t - 2], 17) ^ rot(w[t - 2], 19) ^ (w[t - 2] >> 10);
+			w[t] = w[t - 16] + s0 + w[t - 7] + s1;
+		}
+		uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+		for (int t = 0; t < 64; t++) {
+			const uint32_t t1 = hh + (rot(e, 6) ^ rot(e, 11) ^ rot(e, 25)) + ((e & f) ^ (~e & g)) + K[t] + w[t];
+			const uint32_t t2 = (rot(a, 2) ^ rot(a, 13) ^ rot(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+			hh = g;
+			g = f;
+			f = e;
+			e = d + t1;
+			d = c;
+			c = b;
+			b = a;
+			a = t1 + t2;
+		}
+		h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+		h[4] += e; h[5] += f; h[6] += g; h[7] += hh;
+		block += blockSize;
+	}
+}
+
+#ifdef BLS_SHA256_USE_X86
+__attribute__((target("sha,sse4.1")))
+inline void compressShaNi(uint32_t h[8], const uint8_t *block, size_t blockN)
+{
+	const __m128i mask = _mm_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+	__m128i tmp = _mm_loadu_si128((const __m128i*)&h[0]);
+	__m128i state1 = _mm_loadu_si128((const __m128i*)&h[4]);
+	tmp = _mm_shuffle_epi32(tmp, 0xb1); // CDAB
+	state1 = _mm_shuffle_epi32(state1, 0x1b); // EFGH
+	__m128i state0 = _mm_alignr_epi8(tmp, state1, 8); // ABEF
+	state1 = _mm_blend_epi16(state1, tmp, 0xf0); // CDGH
+	for (size_t i = 0; i < blockN; i++) {
+		const __m128i save0 = state0;
+		const __m128i save1 = state1;
+		__m128i w[4];
+		for (int j = 0; j < 4; j++) {
+			w[j] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(block + j * 16)), mask);
+		}
+		// 4 rounds per step with w[t, t + 4) where t = step * 4
+		for (int step = 0; step < 16; step++) {
+			if (step >= 4) {
+				// w[t] = s1(w[t - 2]) + w[t - 7] + s0(w[t - 15]) + w[t - 16]
+				const __m128i x0 = w[step & 3];
+				const __m128i x1 = w[(step + 1) & 3];
+				const __m128i x2 = w[(step + 2) & 3];
+				const __m128i x3 = w[(step + 3) & 3];
+				tmp = _mm_add_epi32(_mm_sha256msg1_epu32(x0, x1), _mm_alignr_epi8(x3, x2, 4));
+				w[step & 3] = _mm_sha256msg2_epu32(tmp, x3);
+			}
+			__m128i m = _mm_add_epi32(w[step & 3], _mm_loadu_si128((const __m128i*)&K[step * 4]));
+			state1 = _mm_sha256rnds2_epu32(state1, state0, m);
+			m = _mm_shuffle_epi32(m, 0x0e);
+			state0 = _mm_sha256rnds2_epu32(state0, state1, m);
+		}
+		state0 = _mm_add_epi32(state0, save0);
+		state1 = _mm_add_epi32(state1, save1);
+		block += blockSize;
+	}
+	tmp = _mm_shuffle_epi32(state0, 0x1b); // FEBA
+	state1 = _mm_shuffle_epi32(state1, 0xb1); // DCHG
+	state0 = _mm_blend_epi16(tmp, state1, 0xf0); // DCBA
+	state1 = _mm_alignr_epi8(state1, tmp, 8); // HGFE
+	_mm_storeu_si128((__m128i*)&h[0], state0);
+	_mm_storeu_si128((__m128i*)&h[4], state1);
+}
+
+__attribute__((target("avx2")))
+inline __m256i rot8(__m256i x, int s)
+{
+	return _mm256_or_si256(_mm256_srli_epi32(x, s), _mm256_slli_epi32(x, 32 - s));
+}
+
+/*
+	update hVec[j] by blockN blocks of blockVec[j] for j < laneN
+	each lane of a 256-bit register holds a word of a different message
+*/
+__attribute__((target("avx2")))
+inline void compressAvx2X8(uint32_t hVec[][8], const uint8_t *const blockVec[laneN], size_t blockN)
+{
+	const __m256i mask = _mm256_set_epi64x(0x0c0d0e0f08090a0bull, 0x0405060700010203ull, 0x0c0d0e0f08090a0bull, 0x0405060700010203ull);
+	const __m256i idx = _mm256_set_epi32(7 * 8, 6 * 8, 5 * 8, 4 * 8, 3 * 8, 2 * 8, 1 * 8, 0);
+	__m256i h[8];
+	for (int i = 0; i < 8; i++) {
+		h[i] = _mm256_i32gather_epi32((const int*)&hVec[0][i], idx, 4);
+	}
+	for (size_t i = 0; i < blockN; i++) {
+		__m256i w[64];
+		for (int t = 0; t < 16; t++) {
+			const size_t pos = i * blockSize + t * 4;
+			uint32_t v[laneN];
+			for (size_t j = 0; j < laneN; j++) {
+				memcpy(&v[j], blockVec[j] + pos, 4);
+			}
+			w[t] = _mm256_shuffle_epi8(_mm256_loadu_si256((const __m256i*)v), mask);
+		}
+		for (int t = 16; t < 64; t++) {
+			const __m256i x = w[t - 15];
+			const __m256i y = w[t - 2];
+			const __m256i s0 = _mm256_xor_si256(_mm256_xor_si256(rot8(x, 7), rot8(x, 18)), _mm256_srli_epi32(x, 3));
+			const __m256i s1 = _mm256_xor_si256(_mm256_xor_si256(rot8(y, 17), rot8(y, 19)), _mm256_srli_epi32(y, 10));
+			w[t] = _mm256_add_epi32(_mm256_add_epi32(w[t - 16], s0), _mm256_add_epi32(w[t - 7], s1));
+		}
+		__m256i a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], hh = h[7];
+		for (int t = 0; t < 64; t++) {
+			const __m256i S1 = _mm256_xor_si256(_mm256_xor_si256(rot8(e, 6), rot8(e, 11)), rot8(e, 25));
+			const __m256i ch = _mm256_xor_si256(_mm256_and_si256(e, f), _mm256_andnot_si256(e, g));
+			__m256i t1 = _mm256_add_epi32(_mm256_add_epi32(hh, S1), _mm256_add_epi32(ch, w[t]));
+			t1 = _mm256_add_epi32(t1, _mm256_set1_epi32(int(K[t])));
+			const __m256i S0 = _mm256_xor_si256(_mm256_xor_si256(rot8(a, 2), rot8(a, 13)), rot8(a, 22));
+			const __m256i maj = _mm256_or_si256(_mm256_and_si256(a, b), _mm256_and_si256(c, _mm256_or_si256(a, b)));
+			const __m256i t2 = _mm256_add_epi32(S0, maj);
+			hh = g;
+			g = f;
+			f = e;
+			e = _mm256_add_epi32(d, t1);
+			d = c;
+			c = b;
+			b = a;
+			a = _mm256_add_epi32(t1, t2);
+		}
+		h[0] = _mm256_add_epi32(h[0], a); h[1] = _mm256_add_epi32(h[1], b);
+		h[2] = _mm256_add_epi32(h[2], c); h[3] = _mm256_add_epi32(h[3], d);
+		h[4] = _mm256_add_epi32(h[4], e); h[5] = _mm256_add_epi32(h[5], f);
+		h[6] = _mm256_add_epi32(h[6], g); h[7] = _mm256_add_epi32(h[7], hh);
+	}
+	for (int i = 0; i < 8; i++) {
+		uint32_t v[laneN];
+		_mm256_storeu_si256((__m256i*)v, h[i]);
+		for (size_t j = 0; j < laneN; j++) {
+			hVec[j][i] = v[j];
+		}
+	}
+}
+
+// return the implementations which the CPU supports
+inline int getSupportedMode()
+{
+	unsigned int a, b, c, d;
+	if (!__get_cpuid_count(7, 0, &a, &b, &c, &d)) return 0;
+	const unsigned int ebx = b;
+	if (!__get_cpuid(1, &a, &b, &c, &d)) return 0;
+	const bool sse41 = (c & (1u << 19)) != 0;
+	const bool osxsave = (c & (1u << 27)) != 0;
+	const bool avx = (c & (1u << 28)) != 0;
+	int mode = 0;
+	if (sse41 && (ebx & (1u << 29))) mode |= SHA_NI;
+	if (osxsave && avx && (ebx & (1u << 5))) {
+		// the OS saves the ymm registers
+		unsigned int lo, hi;
+		__asm__ volatile("xgetbv" : "=a"(lo), "=d"(hi) : "c"(0));
+		(void)hi;
+		if ((lo & 6) == 6) mode |= AVX2;
+	}
+	return mode;
+}
+#else
+inline int getSupportedMode() { return 0; }
+#endif
+
+/*
+	the current implementations
+	it is read by every hash, so it is atomic unless BLS_DONT_USE_THREAD is defined
+*/
+#ifdef BLS_SHA256_USE_ATOMIC
+inline std::atomic<int>& getModeRef()
+{
+	static std::atomic<int> mode(getSupportedMode());
+	return mode;
+}
+inline int getMode() { return getModeRef().load(std::memory_order_relaxed); }
+inline void setMode(int mode) { getModeRef().store(mode, std::memory_order_relaxed); }
+#else
+inline int& getModeRef()
+{
+	static int mode = getSupportedMode();
+	return mode;
+}
+inline int getMode() { return getModeRef(); }
+inline void setMode(int mode) { getModeRef() = mode; }
+#endif
+
+inline void compress(uint32_t h[8], const uint8_t *block, size_t blockN)
+{
+#ifdef BLS_SHA256_USE_X86
+	if (getMode() & SHA_NI) {
+		compressShaNi(h, block, blockN);
+		return;
+	}
+#endif
+	compressPortable(h, block, blockN);
+}
+
+/*
+	same as compress for each lane
+	SHA-NI is preferred to AVX2 because one SHA-NI stream is faster than 8 lanes of AVX2
+*/
+inline void compressX8(uint32_t hVec[][8], const uint8_t *const blockVec[laneN], size_t blockN)
+{
+#ifdef BLS_SHA256_USE_X86
+	if ((getMode() & (SHA_NI | AVX2)) == AVX2) {
+		compressAvx2X8(hVec, blockVec, blockN);
+		return;
+	}
+#endif
+	for (size_t j = 0; j < laneN; j++) {
+		compress(hVec[j], blockVec[j], blockN);
+	}
+}
+
+inline void getDigest(uint8_t md[mdSize], const uint32_t h[8])
+{
+	for (int i = 0; i < 8; i++) {
+		set32bitAsBE(md + i * 4, h[i]);
+	}
+}
+
+/*
+	write the rest of (buf[0, bufSize) || msg[0, msgSize)) with the padding for totalSize bytes into out
+	return the number of blocks (1 or 2) or 0 if it does not fit in two blocks
+*/
+inline size_t getLastBlock(uint8_t out[blockSize * 2], const uint8_t *buf, size_t bufSize, const void *msg, size_t msgSize, uint64_t totalSize)
+{
+	const size_t n = bufSize + msgSize;
+	if (n + 9 > blockSize * 2) return 0;
+	const size_t blockN = n + 9 > blockSize ? 2 : 1;
+	memcpy(out, buf, bufSize);
+	if (msgSize > 0) memcpy(out + bufSize, msg, msgSize);
+	memset(out + n, 0, blockSize * blockN - n);
+	out[n] = 0x80;
+	const uint64_t bitSize = totalSize * 8;
+	uint8_t *p = out + blockSize * blockN - 8;
+	set32bitAsBE(p, uint32_t(bitSize >> 32));
+	set32bitAsBE(p + 4, uint32_t(bitSize));
+	return blockN;
+}
+
+class Sha256 {
+	uint32_t h_[8];
+	uint8_t buf_[blockSize];
+	size_t bufSize_;
+	uint64_t totalSize_;
+public:
+	Sha256() { clear(); }
+	void clear()
+	{
+		memcpy(h_, H0, sizeof(h_));
+		bufSize_ = 0;
+		totalSize_ = 0;
+	}
+	void update(const void *msg, size_t msgSize)
+	{
+		const uint8_t *p = (const uint8_t*)msg;
+		totalSize_ += msgSize;
+		if (bufSize_ > 0) {
+			size_t n = blockSize - bufSize_;
+			if (n > msgSize) n = msgSize;
+			memcpy(buf_ + bufSize_, p, n);
+			bufSize_ += n;
+			p += n;
+			msgSize -= n;
+			if (bufSize_ < blockSize) return;
+			compress(h_, buf_, 1);
+			bufSize_ = 0;
+		}
+		const size_t blockN = msgSize / blockSize;
+		if (blockN > 0) {
+			compress(h_, p, blockN);
+			p += blockN * blockSize;
+			msgSize -= blockN * blockSize;
+		}
+		if (msgSize > 0) {
+			memcpy(buf_, p, msgSize);
+			bufSize_ = msgSize;
+		}
+	}
+	/*
+		md = SHA-256(updated data || msg[0, msgSize)) without changing the state
+		return mdSize if success else 0 (mdBufSize < mdSize)
+	*/
+	size_t digest(void *md, size_t mdBufSize, const void *msg = 0, size_t msgSize = 0) const
+	{
+		if (mdBufSize < mdSize) return 0;
+		Sha256 h = *this;
+		if (msgSize > 0) h.update(msg, msgSize);
+		uint8_t last[blockSize * 2];
+		const size_t blockN = getLastBlock(last, h.buf_, h.bufSize_, 0, 0, h.totalSize_);
+		compress(h.h_, last, blockN);
+		getDigest((uint8_t*)md, h.h_);
+		return mdSize;
+	}
+	/*
+		mdVec[i * mdSize, (i + 1) * mdSize) = digest(msgVec[i * msgSize, (i + 1) * msgSize)) for i < n
+		compute laneN digests at once if the rest of each message fits in two blocks
+	*/
+	void digestVec(void *mdVec, const void *msgVec, size_t msgSize, size_t n) const
+	{
+		uint8_t *md = (uint8_t*)mdVec;
+		const uint8_t *msg = (const uint8_t*)msgVec;
+		size_t i = 0;
+		if (bufSize_ + msgSize + 9 <= blockSize * 2) {
+			uint8_t last[laneN][blockSize * 2];
+			const uint8_t *blockVec[laneN];
+			uint32_t hVec[laneN][8];
+			for (; i + laneN <= n; i += laneN) {
+				size_t blockN = 0;
+				for (size_t j = 0; j < laneN; j++) {
+					blockN = getLastBlock(last[j], buf_, bufSize_, msg + (i + j) * msgSize, msgSize, totalSize_ + msgSize);
+					blockVec[j] = last[j];
+					memcpy(hVec[j], h_, sizeof(h_));
+				}
+				compressX8(hVec, blockVec, blockN);
+				for (size_t j = 0; j < laneN; j++) {
+					getDigest(md + (i + j) * mdSize, hVec[j]);
+				}
+			}
+		}
+		for (; i < n; i++) {
+			digest(md + i * mdSize, mdSize, msg + i * msgSize, msgSize);
+		}
+	}
+};
+
+// md = SHA-256(msg[0, msgSize)) ; return mdSize if success else 0
+inline size_t sha256(void *md, size_t mdBufSize, const void *msg, size_t msgSize)
+{
+	Sha256 h;
+	return h.digest(md, mdBufSize, msg, msgSize);
+}
+
+} } // bls::sha256
@@ -0,0 +1,180 @@
+#pragma once
+/**
+	@file
+	@brief performance counters of the hot paths
+	@license modified new BSD license
+	http://opensource.org/licenses/BSD-3-Clause
+	@note define BLS_USE_STATS to enable them (C++11 is required)
+	BLS_STATS_CALL(idx, f) runs f and adds one call and the elapsed time to the idx-th counter of the current thread
+	it is just f if BLS_USE_STATS is not defined
+*/
+#ifdef BLS_USE_STATS
+#include <bls/bls.h>
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+namespace bls { namespace stats {
+
+struct Local;
+
+/*
+	the counters of the living threads and the sum of the exited threads
+	the values at the last reset are subtracted on read
+*/
+struct Registry {
+	std::mutex m;
+	std::vector<Local*> localVec;
+	uint64_t retiredCallN[BLS_STATS_N];
+	uint64_t retiredNs[BLS_STATS_N];
+	uint64_t baseCallN[BLS_STATS_N];
+	uint64_t baseNs[BLS_STATS_N];
+	Registry()
+	{
+		memset(retiredCallN, 0, sizeof(retiredCallN));
+		memset(retiredNs, 0, sizeof(retiredNs));
+		memset(baseCallN, 0, sizeof(baseCallN));
+		memset(baseNs, 0, sizeof(baseNs));
+	}
+};
+
+inline Registry& getRegistry()
+{
+	static Registry reg;
+	return reg;
+}
+
+/*
+	the counters of a thread
+	only the owner thread updates them, so relaxed load and store are enough
+*/
+struct Local {
+	std::atomic<uint64_t> callN[BLS_STATS_N];
+	std::atomic<uint64_t> ns[BLS_STATS_N];
+	Local()
+	{
+		for (int i = 0; i < BLS_STATS_N; i++) {
+			callN[i].store(0, std::memory_order_relaxed);
+			ns[i].store(0, std::memory_order_relaxed);
+		}
+		Registry& reg = getRegistry();
+		std::lock_guard<std::mutex> lk(reg.m);
+		reg.localVec.push_back(this);
+	}
+	~Local()
+	{
+		Registry& reg = getRegistry();
+		std::lock_guard<std::mutex> lk(reg.m);
+		for (int i = 0; i < BLS_STATS_N; i++) {
+			reg.retiredCallN[i] += callN[i].load(std::memory_order_relaxed);
+			reg.retiredNs[i] += ns[i].load(std::memory_order_relaxed);
+		}
+		for (size_t i = 0; i < reg.localVec.size(); i++) {
+			if (reg.localVec[i] == this) {
+				reg.localVec[i] = reg.localVec.back();
+				reg.localVec.pop_back();
+				break;
+			}
+		}
+	}
+	void add(int idx, uint64_t t)
+	{
+		callN[idx].store(callN[idx].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		ns[idx].store(ns[idx].load(std::memory_order_relaxed) + t, std::memory_order_relaxed);
+	}
+};
+
+inline Local& getLocal()
+{
+	thread_local Local local;
+	return local;
+}
+
+class Timer {
+	int idx_;
+	std::chrono::steady_clock::time_point begin_;
+public:
+	explicit Timer(int idx)
+		: idx_(idx)
+		, begin_(std::chrono::steady_clock::now())
+	{
+	}
+	~Timer()
+	{
+		const std::chrono::steady_clock::duration d = std::chrono::steady_clock::now() - begin_;
+		getLocal().add(idx_, std::chrono::duration_cast<std::chrono::nanoseconds>(d).count());
+	}
+};
+
+// the sum of all threads since the start
+inline void getTotal(uint64_t callN[BLS_STATS_N], uint64_t ns[BLS_STATS_N], const Registry& reg)
+{
+	for (int i = 0; i < BLS_STATS_N; i++) {
+		callN[i] = reg.retiredCallN[i];
+		ns[i] = reg.retiredNs[i];
+		for (size_t j = 0; j < reg.localVec.size(); j++) {
+			callN[i] += reg.localVec[j]->callN[i].load(std::memory_order_relaxed);
+			ns[i] += reg.localVec[j]->ns[i].load(std::memory_order_relaxed);
+		}
+	}
+}
+
+inline void get(blsStats *stats)
+{
+	Registry& reg = getRegistry();
+	std::lock_guard<std::mutex> lk(reg.m);
+	getTotal(stats->callN, stats->ns, reg);
+	for (int i = 0; i < BLS_STATS_N; i++) {
+		stats->callN[i] -= reg.baseCallN[i];
+		stats->ns[i] -= reg.baseNs[i];
+	}
+}
+
+inline void reset()
+{
+	Registry& reg = getRegistry();
+	std::lock_guard<std::mutex> lk(reg.m);
+	getTotal(reg.baseCallN, reg.baseNs, reg);
+}
+
+/*
+	write stats to buf as the Prometheus text format
+	return strlen(buf) if success else 0
+*/
+inline size_t getText(char *buf, size_t maxBufSize)
+{
+	static const char *nameTbl[BLS_STATS_N] = {
+		"hash_to_curve", "miller_loop", "final_exp", "order_check", "deserialize"
+	};
+	blsStats stats;
+	get(&stats);
+	size_t pos = 0;
+	for (int k = 0; k < 2; k++) {
+		int n = snprintf(buf + pos, maxBufSize - pos, k == 0 ?
+			"# HELP bls_calls_total Number of calls of each phase.\n# TYPE bls_calls_total counter\n" :
+			"# HELP bls_seconds_total Cumulative time of each phase.\n# TYPE bls_seconds_total counter\n");
+		if (n < 0 || size_t(n) >= maxBufSize - pos) return 0;
+		pos += n;
+		for (int i = 0; i < BLS_STATS_N; i++) {
+			if (k == 0) {
+				n = snprintf(buf + pos, maxBufSize - pos, "bls_calls_total{phase=\"%s\"} %llu\n", nameTbl[i], (unsigned long long)stats.callN[i]);
+			} else {
+				n = snprintf(buf + pos, maxBufSize - pos, "bls_seconds_total{phase=\"%s\"} %llu.%09llu\n", nameTbl[i],
+					(unsigned long long)(stats.ns[i] / 1000000000), (unsigned long long)(stats.ns[i] % 1000000000));
+			}
+			if (n < 0 || size_t(n) >= maxBufSize - pos) return 0;
+			pos += n;
+		}
+	}
+	return pos;
+}
+
+} } // bls::stats
+
+#define BLS_STATS_CALL(idx, f) do { bls::stats::Timer blsStatsTimer_(idx); f; } while (0)
+#else
+#define BLS_STATS_CALL(idx, f) f
+#endif
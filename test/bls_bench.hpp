@@ -0,0 +1,753 @@
+/*
+	benchmark of the C API
+	define MCLBN_FP_UNIT_SIZE (and MCLBN_FR_UNIT_SIZE), BLS_BENCH_NAME and BLS_BENCH_CURVE before including this file
+
+	each case is measured for each size n in -n and each thread count t in -t (0 means all CPUs)
+	a case with threadN passes t to the API, and the other cases call the API on t threads at once
+	it prints ops/s (calls of the API per second) and p50/p99 latency of a call, and writes them to -o as JSON
+
+	-base file.json runs the cases in the file again and compares ops/s with them
+	it returns 2 if a case regresses more than -th percent
+*/
+#include <bls/bls.h>
+#include <cybozu/option.hpp>
+#include <cybozu/inttype.hpp>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace bench {
+
+const size_t msgSize = 32;
+
+/*
+	input of the cases
+	the vectors have maxN elements and the aggregated signatures are of the first n elements
+*/
+struct Data {
+	size_t n;
+	std::vector<blsSecretKey> secVec;
+	std::vector<blsPublicKey> pubVec;
+	std::vector<blsSignature> sigVec; // sigVec[i] = sign(secVec[i], msg[i])
+	std::vector<blsSignature> sameSigVec; // sameSigVec[i] = sign(secVec[i], msg[0])
+	std::vector<blsId> idVec;
+	std::vector<mclBnFr> coeffVec;
+	std::vector<uint8_t> msgBuf; // msg[i] = msgBuf[i * msgSize, (i + 1) * msgSize)
+	std::vector<const void*> msgPtrVec;
+	std::vector<mclSize> msgSizeVec;
+	std::vector<uint8_t> pubBuf; // serialized pubVec
+	std::vector<uint8_t> sigBuf; // serialized sigVec
+	mclSize pubStride;
+	mclSize sigStride;
+	blsSignature aggSig; // aggregated sigVec[0, n)
+	blsSignature sameAggSig; // aggregated sameSigVec[0, n)
+	blsRecoveryPlan plan; // of idVec[0, n)
+	explicit Data(size_t maxN)
+		: n(0)
+		, secVec(maxN)
+		, pubVec(maxN)
+		, sigVec(maxN)
+		, sameSigVec(maxN)
+		, idVec(maxN)
+		, coeffVec(maxN)
+		, msgBuf(maxN * msgSize)
+		, msgPtrVec(maxN)
+		, msgSizeVec(maxN, msgSize)
+	{
+		pubStride = blsGetSerializedPublicKeyByteSize();
+		sigStride = blsGetSerializedSignatureByteSize();
+		pubBuf.resize(maxN * pubStride);
+		sigBuf.resize(maxN * sigStride);
+		for (size_t i = 0; i < maxN; i++) {
+			for (size_t j = 0; j < msgSize; j++) {
+				msgBuf[i * msgSize + j] = uint8_t(i * 7 + j);
+			}
+			msgPtrVec[i] = &msgBuf[i * msgSize];
+			blsIdSetInt(&idVec[i], int(i + 1));
+			blsSecretKeySetByCSPRNG(&secVec[i]);
+		}
+		blsGetPublicKeyVec(&pubVec[0], &secVec[0], maxN, 0);
+		blsSignVec(&sigVec[0], &secVec[0], &msgPtrVec[0], &msgSizeVec[0], maxN, 0);
+		blsSignSameMessageMT(&sameSigVec[0], &secVec[0], maxN, msg(0), msgSize, 0);
+		blsPublicKeySerializeVec(&pubBuf[0], pubStride, &pubVec[0], maxN, 0);
+		blsSignatureSerializeVec(&sigBuf[0], sigStride, &sigVec[0], maxN, 0);
+	}
+	const void *msg(size_t i) const { return &msgBuf[i * msgSize]; }
+	void setN(size_t _n)
+	{
+		n = _n;
+		blsAggregateSignature(&aggSig, &sigVec[0], n);
+		blsAggregateSignature(&sameAggSig, &sameSigVec[0], n);
+		blsRecoveryPlanInitMT(&plan, &coeffVec[0], &idVec[0], n, 0);
+	}
+};
+
+// output of a call owned by each calling thread
+struct Work {
+	blsPublicKey pub;
+	blsSignature sig;
+	std::vector<blsSignature> sigVec;
+	std::vector<blsPublicKey> pubVec;
+	std::vector<int> okVec;
+	std::vector<mclBnFr> coeffVec;
+	std::vector<uint8_t> buf;
+	explicit Work(size_t maxN)
+		: sigVec(maxN)
+		, pubVec(maxN)
+		, okVec(maxN)
+		, coeffVec(maxN)
+		, buf(1024)
+	{
+	}
+};
+
+// call the API once and return false if the result is wrong
+typedef bool (*CaseFunc)(Work& w, const Data& d, size_t threadN);
+
+bool signCase(Work& w, const Data& d, size_t)
+{
+	blsSign(&w.sig, &d.secVec[0], d.msg(0), msgSize);
+	return blsSignatureIsEqual(&w.sig, &d.sigVec[0]) == 1;
+}
+
+bool verifyCase(Work&, const Data& d, size_t)
+{
+	return blsVerify(&d.sigVec[0], &d.pubVec[0], d.msg(0), msgSize) == 1;
+}
+
+bool getPublicKeyCase(Work& w, const Data& d, size_t)
+{
+	blsGetPublicKey(&w.pub, &d.secVec[0]);
+	return blsPublicKeyIsEqual(&w.pub, &d.pubVec[0]) == 1;
+}
+
+bool signatureSerializeCase(Work& w, const Data& d, size_t)
+{
+	return blsSignatureSerialize(&w.buf[0], w.buf.size(), &d.sigVec[0]) == d.sigStride;
+}
+
+bool signatureDeserializeCase(Work& w, const Data& d, size_t)
+{
+	return blsSignatureDeserialize(&w.sig, &d.sigBuf[0], d.sigStride) == d.sigStride;
+}
+
+bool publicKeySerializeCase(Work& w, const Data& d, size_t)
+{
+	return blsPublicKeySerialize(&w.buf[0], w.buf.size(), &d.pubVec[0]) == d.pubStride;
+}
+
+bool publicKeyDeserializeCase(Work& w, const Data& d, size_t)
+{
+	return blsPublicKeyDeserialize(&w.pub, &d.pubBuf[0], d.pubStride) == d.pubStride;
+}
+
+bool signVecCase(Work& w, const Data& d, size_t threadN)
+{
+	blsSignVec(&w.sigVec[0], &d.secVec[0], &d.msgPtrVec[0], &d.msgSizeVec[0], d.n, threadN);
+	return blsSignatureIsEqual(&w.sigVec[d.n - 1], &d.sigVec[d.n - 1]) == 1;
+}
+
+bool fastAggregateVerifyCase(Work&, const Data& d, size_t)
+{
+	return blsFastAggregateVerify(&d.sameAggSig, &d.pubVec[0], d.n, d.msg(0), msgSize) == 1;
+}
+
+bool aggregateVerifyCase(Work&, const Data& d, size_t threadN)
+{
+	return blsAggregateVerifyNoCheckMT(&d.aggSig, &d.pubVec[0], &d.msgBuf[0], msgSize, d.n, threadN) == 1;
+}
+
+bool multiAggregateSignatureCase(Work& w, const Data& d, size_t threadN)
+{
+	blsMultiAggregateSignatureMT(&w.sig, const_cast<blsSignature*>(&d.sigVec[0]), const_cast<blsPublicKey*>(&d.pubVec[0]), d.n, threadN);
+	return true;
+}
+
+bool multiAggregatePublicKeyCase(Work& w, const Data& d, size_t threadN)
+{
+	blsMultiAggregatePublicKeyMT(&w.pub, const_cast<blsPublicKey*>(&d.pubVec[0]), d.n, threadN);
+	return true;
+}
+
+// the shares are not of one polynomial because only the time matters
+bool signatureRecoverCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsSignatureRecoverMT(&w.sig, &d.sigVec[0], &d.idVec[0], d.n, threadN) == 0;
+}
+
+bool publicKeyRecoverCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsPublicKeyRecoverMT(&w.pub, &d.pubVec[0], &d.idVec[0], d.n, threadN) == 0;
+}
+
+bool recoveryPlanInitCase(Work& w, const Data& d, size_t threadN)
+{
+	blsRecoveryPlan plan;
+	return blsRecoveryPlanInitMT(&plan, &w.coeffVec[0], &d.idVec[0], d.n, threadN) == 0;
+}
+
+bool signatureRecoverByPlanCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsSignatureRecoverByPlanMT(&w.sig, &d.sigVec[0], &d.plan, threadN) == 0;
+}
+
+bool publicKeyRecoverByPlanCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsPublicKeyRecoverByPlanMT(&w.pub, &d.pubVec[0], &d.plan, threadN) == 0;
+}
+
+bool signatureSerializeVecCase(Work& w, const Data& d, size_t threadN)
+{
+	w.buf.resize(d.n * d.sigStride);
+	return blsSignatureSerializeVec(&w.buf[0], d.sigStride, &d.sigVec[0], d.n, threadN) == d.n;
+}
+
+bool signatureDeserializeVecCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsSignatureDeserializeVec(&w.sigVec[0], &w.okVec[0], &d.sigBuf[0], d.sigStride, d.n, threadN) == d.n;
+}
+
+bool publicKeyDeserializeVecCase(Work& w, const Data& d, size_t threadN)
+{
+	return blsPublicKeyDeserializeVec(&w.pubVec[0], &w.okVec[0], &d.pubBuf[0], d.pubStride, d.n, threadN) == d.n;
+}
+
+struct Case {
+	const char *name;
+	bool useN; // the API takes n elements, otherwise run only for n = 1
+	bool useThreadN; // the API takes threadN, otherwise call it on threadN threads at once
+	CaseFunc f;
+};
+
+const Case caseTbl[] = {
+	{ "sign", false, false, signCase },
+	{ "verify", false, false, verifyCase },
+	{ "getPublicKey", false, false, getPublicKeyCase },
+	{ "signatureSerialize", false, false, signatureSerializeCase },
+	{ "signatureDeserialize", false, false, signatureDeserializeCase },
+	{ "publicKeySerialize", false, false, publicKeySerializeCase },
+	{ "publicKeyDeserialize", false, false, publicKeyDeserializeCase },
+	{ "signVec", true, true, signVecCase },
+	{ "fastAggregateVerify", true, false, fastAggregateVerifyCase },
+	{ "aggregateVerifyNoCheck", true, true, aggregateVerifyCase },
+	{ "multiAggregateSignature", true, true, multiAggregateSignatureCase },
+	{ "multiAggregatePublicKey", true, true, multiAggregatePublicKeyCase },
+	{ "signatureRecover", true, true, signatureRecoverCase },
+	{ "publicKeyRecover", true, true, publicKeyRecoverCase },
+	{ "recoveryPlanInit", true, true, recoveryPlanInitCase },
+	{ "signatureRecoverByPlan", true, true, signatureRecoverByPlanCase },
+	{ "publicKeyRecoverByPlan", true, true, publicKeyRecoverByPlanCase },
+	{ "signatureSerializeVec", true, true, signatureSerializeVecCase },
+	{ "signatureDeserializeVec", true, true, signatureDeserializeVecCase },
+	{ "publicKeyDeserializeVec", true, true, publicKeyDeserializeVecCase },
+};
+
+struct Result {
+	std::string name;
+	size_t n;
+	size_t threadN;
+	size_t trialN;
+	size_t callN; // calls of all trials
+	double sec; // elapsed time of all trials
+	double opsPerSec; // mean of the trials
+	double opsPerSecStd; // sample standard deviation of the trials (0 if trialN = 1)
+	double p50; // latency of a call in usec
+	double p99;
+	Result()
+		: n(0), threadN(0), trialN(0), callN(0), sec(0), opsPerSec(0), opsPerSecStd(0), p50(0), p99(0)
+	{
+	}
+};
+
+typedef std::chrono::steady_clock Clock;
+
+inline double getSec(Clock::duration d)
+{
+	return std::chrono::duration<double>(d).count();
+}
+
+/*
+	call c.f until minSec has passed and minCallN calls are done
+	latVec receives the latency of each call in usec
+*/
+inline bool runCase(std::vector<double>& latVec, Work& w, const Case& c, const Data& d, size_t apiThreadN, double minSec, size_t minCallN)
+{
+	const Clock::time_point end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(minSec));
+	bool ok = true;
+	for (;;) {
+		const Clock::time_point t0 = Clock::now();
+		ok &= c.f(w, d, apiThreadN);
+		const Clock::time_point t1 = Clock::now();
+		latVec.push_back(getSec(t1 - t0) * 1e6);
+		if (latVec.size() >= minCallN && t1 >= end) break;
+	}
+	return ok;
+}
+
+// nearest-rank percentile of sorted v
+inline double getPercentile(const std::vector<double>& v, double p)
+{
+	size_t i = size_t(p * v.size() + 0.999999);
+	if (i > 0) i--;
+	if (i >= v.size()) i = v.size() - 1;
+	return v[i];
+}
+
+inline void getMeanStd(double& mean, double& std, const std::vector<double>& v)
+{
+	const size_t n = v.size();
+	mean = 0;
+	for (size_t i = 0; i < n; i++) mean += v[i];
+	mean /= n;
+	std = 0;
+	if (n < 2) return;
+	for (size_t i = 0; i < n; i++) std += (v[i] - mean) * (v[i] - mean);
+	std = sqrt(std / (n - 1));
+}
+
+/*
+	run c once for d.n elements on threadN threads
+	append the latency of each call to latVec and set the elapsed time to sec
+	return false if the API returns a wrong result
+*/
+inline bool measureOnce(std::vector<double>& latVec, double& sec, const Case& c, const Data& d, size_t threadN, double minSec, size_t minCallN)
+{
+	const size_t callerN = c.useThreadN ? 1 : threadN;
+	const size_t apiThreadN = c.useThreadN ? threadN : 1;
+	std::vector<std::vector<double> > latVecVec(callerN);
+	std::vector<Work*> workVec(callerN);
+	for (size_t i = 0; i < callerN; i++) {
+		workVec[i] = new Work(d.n);
+	}
+	// warm up and check the result
+	bool ok = c.f(*workVec[0], d, apiThreadN);
+	std::vector<char> okVec(callerN);
+	const Clock::time_point begin = Clock::now();
+	if (ok) {
+		if (callerN == 1) {
+			okVec[0] = runCase(latVecVec[0], *workVec[0], c, d, apiThreadN, minSec, minCallN);
+		} else {
+			std::vector<std::thread> thVec;
+			for (size_t i = 0; i < callerN; i++) {
+				thVec.push_back(std::thread([&, i]() {
+					okVec[i] = runCase(latVecVec[i], *workVec[i], c, d, apiThreadN, minSec, minCallN);
+				}));
+			}
+			for (size_t i = 0; i < callerN; i++) {
+				thVec[i].join();
+			}
+		}
+	}
+	sec = getSec(Clock::now() - begin);
+	for (size_t i = 0; i < callerN; i++) {
+		delete workVec[i];
+		ok &= okVec[i];
+	}
+	if (!ok) return false;
+	for (size_t i = 0; i < callerN; i++) {
+		latVec.insert(latVec.end(), latVecVec[i].begin(), latVecVec[i].end());
+	}
+	return true;
+}
+
+// measure c trialN times
+inline bool measure(Result& r, const Case& c, const Data& d, size_t threadN, double minSec, size_t minCallN, size_t trialN)
+{
+	std::vector<double> latVec;
+	std::vector<double> opsVec(trialN);
+	r.sec = 0;
+	for (size_t i = 0; i < trialN; i++) {
+		const size_t prevN = latVec.size();
+		double sec;
+		if (!measureOnce(latVec, sec, c, d, threadN, minSec, minCallN)) return false;
+		opsVec[i] = (latVec.size() - prevN) / sec;
+		r.sec += sec;
+	}
+	std::sort(latVec.begin(), latVec.end());
+	r.name = c.name;
+	r.n = d.n;
+	r.threadN = threadN;
+	r.trialN = trialN;
+	r.callN = latVec.size();
+	getMeanStd(r.opsPerSec, r.opsPerSecStd, opsVec);
+	r.p50 = getPercentile(latVec, 0.50);
+	r.p99 = getPercentile(latVec, 0.99);
+	return true;
+}
+
+// two-sided 95% quantile of Student's t-distribution with df degrees of freedom
+inline double getT95(double df)
+{
+	static const double tbl[] = {
+		12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+		2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+		2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042,
+	};
+	const size_t i = df < 1 ? 1 : size_t(df); // round down to be conservative
+	return i <= CYBOZU_NUM_OF_ARRAY(tbl) ? tbl[i - 1] : 1.960;
+}
+
+struct Delta {
+	double pct; // (r - base) / base in percent
+	double lo; // 95% confidence interval of pct
+	double hi;
+	bool regressed;
+	bool improved;
+};
+
+/*
+	compare opsPerSec of r with base by Welch's t-interval of the difference of the means
+	a case regresses if it is more than threshold percent slower and the interval is below zero
+*/
+inline void compare(Delta& dt, const Result& base, const Result& r, double threshold)
+{
+	const double v1 = r.trialN > 1 ? r.opsPerSecStd * r.opsPerSecStd / r.trialN : 0;
+	const double v2 = base.trialN > 1 ? base.opsPerSecStd * base.opsPerSecStd / base.trialN : 0;
+	const double se = sqrt(v1 + v2);
+	double t = 0;
+	if (se > 0) {
+		double den = 0;
+		if (r.trialN > 1) den += v1 * v1 / (r.trialN - 1);
+		if (base.trialN > 1) den += v2 * v2 / (base.trialN - 1);
+		t = getT95((v1 + v2) * (v1 + v2) / den);
+	}
+	const double diff = r.opsPerSec - base.opsPerSec;
+	dt.pct = diff / base.opsPerSec * 100;
+	dt.lo = (diff - t * se) / base.opsPerSec * 100;
+	dt.hi = (diff + t * se) / base.opsPerSec * 100;
+	dt.regressed = dt.pct < -threshold && dt.hi < 0;
+	dt.improved = dt.pct > threshold && dt.lo > 0;
+}
+
+// split "1,8,64" into numbers
+inline bool parseList(std::vector<size_t>& v, const std::string& s)
+{
+	v.clear();
+	size_t pos = 0;
+	for (;;) {
+		const size_t next = s.find(',', pos);
+		const std::string t = s.substr(pos, next == std::string::npos ? std::string::npos : next - pos);
+		char *endp;
+		const unsigned long x = strtoul(t.c_str(), &endp, 10);
+		if (t.empty() || *endp) return false;
+		v.push_back(x);
+		if (next == std::string::npos) return true;
+		pos = next + 1;
+	}
+}
+
+inline bool isSelected(const std::string& caseList, const char *name)
+{
+	if (caseList.empty()) return true;
+	const std::string s = "," + caseList + ",";
+	return s.find("," + std::string(name) + ",") != std::string::npos;
+}
+
+inline const char *getCurveName(int curveType)
+{
+	switch (curveType) {
+	case MCL_BN254: return "BN254";
+	case MCL_BN381_1: return "BN381_1";
+	case MCL_BN462: return "BN462";
+	case MCL_BLS12_381: return "BLS12_381";
+	default: return "unknown";
+	}
+}
+
+inline bool isEthMode()
+{
+#ifdef BLS_ETH
+	return true;
+#else
+	return false;
+#endif
+}
+
+inline bool isSwapG()
+{
+#ifdef BLS_SWAP_G
+	return true;
+#else
+	return false;
+#endif
+}
+
+inline void printDelta(const Result& base, const Result& r, const Delta& dt)
+{
+	printf("%-24s n=%5d t=%3d %12.1f -> %12.1f ops/s %+7.1f%% [%+7.1f%%, %+7.1f%%] %s\n",
+		r.name.c_str(), (int)r.n, (int)r.threadN, base.opsPerSec, r.opsPerSec, dt.pct, dt.lo, dt.hi,
+		dt.regressed ? "REGRESSION" : dt.improved ? "improved" : "ok");
+}
+
+inline void printResult(const Result& r)
+{
+	printf("%-24s n=%5d t=%3d %12.1f ops/s p50=%10.1fus p99=%10.1fus calls=%d\n",
+		r.name.c_str(), (int)r.n, (int)r.threadN, r.opsPerSec, r.p50, r.p99, (int)r.callN);
+}
+
+inline bool writeJson(const std::string& file, int curveType, double minSec, const std::vector<Result>& rv)
+{
+	FILE *fp = fopen(file.c_str(), "w");
+	if (fp == 0) return false;
+	fprintf(fp, "{\n");
+	fprintf(fp, "  \"library\": \"%s\",\n", BLS_BENCH_NAME);
+	fprintf(fp, "  \"curve\": \"%s\",\n", getCurveName(curveType));
+	fprintf(fp, "  \"eth\": %s,\n", isEthMode() ? "true" : "false");
+	fprintf(fp, "  \"swapG\": %s,\n", isSwapG() ? "true" : "false");
+	fprintf(fp, "  \"cpuN\": %d,\n", (int)std::thread::hardware_concurrency());
+	fprintf(fp, "  \"minSec\": %g,\n", minSec);
+	fprintf(fp, "  \"results\": [\n");
+	for (size_t i = 0; i < rv.size(); i++) {
+		const Result& r = rv[i];
+		fprintf(fp, "    {\"name\": \"%s\", \"n\": %d, \"threadN\": %d, \"trialN\": %d, \"callN\": %d, \"sec\": %.6f, \"opsPerSec\": %.3f, \"opsPerSecStd\": %.3f, \"p50Usec\": %.3f, \"p99Usec\": %.3f}%s\n",
+			r.name.c_str(), (int)r.n, (int)r.threadN, (int)r.trialN, (int)r.callN, r.sec, r.opsPerSec, r.opsPerSecStd, r.p50, r.p99, i + 1 < rv.size() ? "," : "");
+	}
+	fprintf(fp, "  ]\n}\n");
+	return fclose(fp) == 0;
+}
+
+/*
+	get the value of "key" in obj as a string
+	this is not a general JSON parser but reads the flat objects written by writeJson
+*/
+inline bool getValue(std::string& v, const std::string& obj, const char *key)
+{
+	const std::string k = std::string("\"") + key + "\"";
+	size_t p = obj.find(k);
+	if (p == std::string::npos) return false;
+	p = obj.find(':', p + k.size());
+	if (p == std::string::npos) return false;
+	p = obj.find_first_not_of(" \t\r\n", p + 1);
+	if (p == std::string::npos) return false;
+	size_t q;
+	if (obj[p] == '"') {
+		p++;
+		q = obj.find('"', p);
+		if (q == std::string::npos) return false;
+	} else {
+		q = obj.find_first_of(", \t\r\n", p);
+		if (q == std::string::npos) q = obj.size();
+	}
+	v = obj.substr(p, q - p);
+	return true;
+}
+
+inline bool getValue(double& v, const std::string& obj, const char *key)
+{
+	std::string s;
+	if (!getValue(s, obj, key)) return false;
+	char *endp;
+	v = strtod(s.c_str(), &endp);
+	return !s.empty() && *endp == '\0';
+}
+
+inline bool getValue(size_t& v, const std::string& obj, const char *key)
+{
+	double x;
+	if (!getValue(x, obj, key) || x < 0) return false;
+	v = size_t(x);
+	return true;
+}
+
+// read the results written by writeJson
+inline bool loadJson(std::vector<Result>& rv, std::string& library, std::string& curve, const std::string& file)
+{
+	FILE *fp = fopen(file.c_str(), "rb");
+	if (fp == 0) return false;
+	std::string s;
+	char buf[4096];
+	for (;;) {
+		const size_t readSize = fread(buf, 1, sizeof(buf), fp);
+		if (readSize == 0) break;
+		s.append(buf, readSize);
+	}
+	fclose(fp);
+	const size_t top = s.find("\"results\"");
+	if (top == std::string::npos) return false;
+	const std::string header = s.substr(0, top);
+	if (!getValue(library, header, "library") || !getValue(curve, header, "curve")) return false;
+	rv.clear();
+	size_t pos = top;
+	for (;;) {
+		const size_t begin = s.find('{', pos);
+		if (begin == std::string::npos) return true;
+		const size_t end = s.find('}', begin);
+		if (end == std::string::npos) return false;
+		const std::string obj = s.substr(begin + 1, end - begin - 1);
+		Result r;
+		if (!getValue(r.name, obj, "name") || !getValue(r.n, obj, "n") || !getValue(r.threadN, obj, "threadN") || !getValue(r.opsPerSec, obj, "opsPerSec")) {
+			return false;
+		}
+		if (!getValue(r.trialN, obj, "trialN")) r.trialN = 1;
+		getValue(r.opsPerSecStd, obj, "opsPerSecStd");
+		getValue(r.callN, obj, "callN");
+		getValue(r.sec, obj, "sec");
+		getValue(r.p50, obj, "p50Usec");
+		getValue(r.p99, obj, "p99Usec");
+		if (r.n == 0 || r.threadN == 0 || r.opsPerSec <= 0) return false;
+		rv.push_back(r);
+		pos = end + 1;
+	}
+}
+
+inline const Case *findCase(const std::string& name)
+{
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(caseTbl); i++) {
+		if (name == caseTbl[i].name) return &caseTbl[i];
+	}
+	return 0;
+}
+
+struct Job {
+	const Case *c;
+	size_t n;
+	size_t threadN;
+	const Result *base; // compare with it if not null
+};
+
+} // bench
+
+int main(int argc, char *argv[])
+	try
+{
+	using namespace bench;
+	std::string nStr;
+	std::string threadStr;
+	std::string caseList;
+	std::string outFile;
+	std::string baseFile;
+	int curveType;
+	int minMsec;
+	int minCallN;
+	int trialN;
+	double threshold;
+	bool list;
+	cybozu::Option opt;
+	opt.appendOpt(&nStr, "1,16,128,1024", "n", ": comma-separated numbers of elements");
+	opt.appendOpt(&threadStr, "1,0", "t", ": comma-separated numbers of threads (0 means all CPUs)");
+	opt.appendOpt(&caseList, "", "c", ": comma-separated case names (all cases if empty)");
+	opt.appendOpt(&outFile, "", "o", ": write the results to the file as JSON");
+	opt.appendOpt(&baseFile, "", "base", ": compare with the results in the JSON file (-n and -t are ignored)");
+	opt.appendOpt(&curveType, BLS_BENCH_CURVE, "curve", ": curve type");
+	opt.appendOpt(&minMsec, 300, "ms", ": minimum time of each trial in msec");
+	opt.appendOpt(&minCallN, 5, "call", ": minimum number of calls of each thread in each trial");
+	opt.appendOpt(&trialN, 0, "trial", ": number of trials of each case (default 1, or 5 with -base)");
+	opt.appendOpt(&threshold, 5.0, "th", ": regression threshold of ops/s in percent");
+	opt.appendBoolOpt(&list, "l", ": list the cases");
+	opt.appendHelp("h");
+	if (!opt.parse(argc, argv)) {
+		opt.usage();
+		return 1;
+	}
+	if (list) {
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(caseTbl); i++) {
+			printf("%s\n", caseTbl[i].name);
+		}
+		return 0;
+	}
+	if (trialN <= 0) trialN = baseFile.empty() ? 1 : 5;
+	const size_t cpuN = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+	std::vector<Result> baseVec;
+	std::vector<Job> jobVec;
+	if (baseFile.empty()) {
+		std::vector<size_t> nVec, threadVec;
+		if (!parseList(nVec, nStr) || !parseList(threadVec, threadStr)) {
+			fprintf(stderr, "bad list -n %s -t %s\n", nStr.c_str(), threadStr.c_str());
+			return 1;
+		}
+		if (*std::min_element(nVec.begin(), nVec.end()) == 0) {
+			fprintf(stderr, "n must be positive\n");
+			return 1;
+		}
+		for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(caseTbl); i++) {
+			const Case& c = caseTbl[i];
+			if (!isSelected(caseList, c.name)) continue;
+			for (size_t j = 0; j < nVec.size(); j++) {
+				if (!c.useN && j > 0) break;
+				for (size_t k = 0; k < threadVec.size(); k++) {
+					const Job job = { &c, c.useN ? nVec[j] : 1, threadVec[k] == 0 ? cpuN : threadVec[k], 0 };
+					jobVec.push_back(job);
+				}
+			}
+		}
+	} else {
+		std::string library, curve;
+		if (!loadJson(baseVec, library, curve, baseFile)) {
+			fprintf(stderr, "can't load %s\n", baseFile.c_str());
+			return 1;
+		}
+		if (library != BLS_BENCH_NAME || curve != getCurveName(curveType)) {
+			fprintf(stderr, "warning : %s is of %s curve=%s\n", baseFile.c_str(), library.c_str(), curve.c_str());
+		}
+		for (size_t i = 0; i < baseVec.size(); i++) {
+			const Result& base = baseVec[i];
+			if (!isSelected(caseList, base.name.c_str())) continue;
+			const Case *c = findCase(base.name);
+			if (c == 0) {
+				fprintf(stderr, "warning : unknown case %s\n", base.name.c_str());
+				continue;
+			}
+			const Job job = { c, base.n, base.threadN, &base };
+			jobVec.push_back(job);
+		}
+	}
+	if (jobVec.empty()) {
+		fprintf(stderr, "no case\n");
+		return 1;
+	}
+	size_t maxN = 1;
+	for (size_t i = 0; i < jobVec.size(); i++) {
+		maxN = std::max(maxN, jobVec[i].n);
+	}
+	int ret = blsInit(curveType, MCLBN_COMPILED_TIME_VAR);
+	if (ret) {
+		fprintf(stderr, "blsInit err %d\n", ret);
+		return 1;
+	}
+	printf("%s curve=%s eth=%d swapG=%d cpuN=%d trialN=%d\n", BLS_BENCH_NAME, getCurveName(curveType), isEthMode(), isSwapG(), (int)cpuN, trialN);
+	Data d(maxN);
+	const double minSec = minMsec * 1e-3;
+	std::vector<Result> rv;
+	int errN = 0;
+	int regressionN = 0;
+	for (size_t i = 0; i < jobVec.size(); i++) {
+		const Job& job = jobVec[i];
+		d.setN(job.n);
+		Result r;
+		if (!measure(r, *job.c, d, job.threadN, minSec, minCallN, trialN)) {
+			fprintf(stderr, "ERR %s n=%d t=%d returns a wrong result\n", job.c->name, (int)job.n, (int)job.threadN);
+			errN++;
+			continue;
+		}
+		rv.push_back(r);
+		if (job.base) {
+			Delta dt;
+			compare(dt, *job.base, r, threshold);
+			printDelta(*job.base, r, dt);
+			if (dt.regressed) regressionN++;
+		} else {
+			printResult(r);
+		}
+	}
+	if (!outFile.empty()) {
+		if (!writeJson(outFile, curveType, minSec, rv)) {
+			fprintf(stderr, "can't write %s\n", outFile.c_str());
+			return 1;
+		}
+		printf("write %s\n", outFile.c_str());
+	}
+	if (!baseFile.empty()) {
+		printf("regression %d / %d cases (threshold %g%%)\n", regressionN, (int)rv.size(), threshold);
+	}
+	if (errN) return 1;
+	return regressionN ? 2 : 0;
+} catch (std::exception& e) {
+	fprintf(stderr, "ERR %s\n", e.what());
+	return 1;
+}
@@ -0,0 +1,4 @@
+#define MCLBN_FP_UNIT_SIZE 4
+#define BLS_BENCH_NAME "bls_c256"
+#define BLS_BENCH_CURVE MCL_BN254
+#include "bls_bench.hpp"
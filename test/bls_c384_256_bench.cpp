@@ -0,0 +1,5 @@
+#define MCLBN_FP_UNIT_SIZE 6
+#define MCLBN_FR_UNIT_SIZE 4
+#define BLS_BENCH_NAME "bls_c384_256"
+#define BLS_BENCH_CURVE MCL_BLS12_381
+#include "bls_bench.hpp"
@@ -0,0 +1,4 @@
+#define MCLBN_FP_UNIT_SIZE 6
+#define BLS_BENCH_NAME "bls_c384"
+#define BLS_BENCH_CURVE MCL_BN381_1
+#include "bls_bench.hpp"
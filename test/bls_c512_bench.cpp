@@ -0,0 +1,4 @@
+#define MCLBN_FP_UNIT_SIZE 8
+#define BLS_BENCH_NAME "bls_c512"
+#define BLS_BENCH_CURVE MCL_BN462
+#include "bls_bench.hpp"
@@ -2,9 +2,14 @@
 #include <cybozu/inttype.hpp>
 #include <bls/bls.h>
 #include <string.h>
+#include <stdlib.h>
+#include <vector>
 #include <cybozu/benchmark.hpp>
 #include <mcl/gmp_util.hpp>
 
+// the numbers of threads passed to the multi-thread APIs (0 means all CPUs)
+const size_t threadTbl[] = { 1, 0, 2, 3, 4 };
+
 size_t pubSize(size_t FrSize)
 {
 #ifdef BLS_SWAP_G
@@ -353,6 +358,499 @@ void blsBench()
 	CYBOZU_BENCH_C("verify", 300, blsVerify, &sig, &pub, msg, msgSize);
 }
 
+void blsSignSameMessageTestOne(const blsSecretKey *secVec, blsSignature *sigVec, size_t n)
+{
+	const char *msg = "same message";
+	const size_t msgSize = strlen(msg);
+	char h[48];
+	for (size_t i = 0; i < sizeof(h); i++) {
+		h[i] = char(i * 5 + 1);
+	}
+	for (size_t t = 0; t < CYBOZU_NUM_OF_ARRAY(threadTbl); t++) {
+		const size_t threadN = threadTbl[t];
+		memset(sigVec, 0, sizeof(blsSignature) * n);
+		blsSignSameMessageMT(sigVec, secVec, n, msg, msgSize, threadN);
+		for (size_t i = 0; i < n; i++) {
+			blsSignature sig;
+			blsSign(&sig, &secVec[i], msg, msgSize);
+			CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sigVec[i]));
+		}
+		blsSignature sig;
+		const int ret = blsSignHash(&sig, &secVec[0], h, sizeof(h));
+		CYBOZU_TEST_EQUAL(blsSignHashSameMessageMT(sigVec, secVec, n, h, sizeof(h), threadN), ret);
+		if (ret != 0) continue;
+		for (size_t i = 0; i < n; i++) {
+			blsSignHash(&sig, &secVec[i], h, sizeof(h));
+			CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sigVec[i]));
+		}
+	}
+}
+
+void blsSignSameMessageTest()
+{
+	const size_t n = 64;
+	blsSecretKey secVec[n];
+	blsSignature sigVec[n];
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKeySetByCSPRNG(&secVec[i]);
+	}
+	blsSignSameMessageTestOne(secVec, sigVec, n);
+#ifdef BLS_ETH
+	// the cofactor adjustment of BLS_ETH_MODE_OLD
+	if (blsSetETHmode(BLS_ETH_MODE_LATEST) == 0) {
+		blsSignSameMessageTestOne(secVec, sigVec, n);
+		blsSetETHmode(BLS_ETH_MODE_OLD);
+	}
+#endif
+	CYBOZU_BENCH_C("signSameMsg", 3, blsSignSameMessageMT, sigVec, secVec, n, "abc", 3, 1);
+	CYBOZU_BENCH_C("signSameMsgMT", 3, blsSignSameMessageMT, sigVec, secVec, n, "abc", 3, 0);
+}
+
+void blsSignVecTest()
+{
+	const size_t n = 256;
+	std::vector<blsSecretKey> secVec(n);
+	std::vector<blsSignature> sigVec(n);
+	std::vector<char> msgTbl(32 * n);
+	std::vector<const void*> msgPtrVec(n);
+	std::vector<mclSize> msgSizeVec(n);
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKeySetByCSPRNG(&secVec[i]);
+		for (size_t j = 0; j < 32; j++) {
+			msgTbl[i * 32 + j] = char(i * 7 + j);
+		}
+		msgPtrVec[i] = &msgTbl[i * 32];
+		msgSizeVec[i] = i % 33; // including an empty message
+	}
+	for (size_t t = 0; t < CYBOZU_NUM_OF_ARRAY(threadTbl); t++) {
+		memset(&sigVec[0], 0, sizeof(blsSignature) * n);
+		blsSignVec(&sigVec[0], &secVec[0], &msgPtrVec[0], &msgSizeVec[0], n, threadTbl[t]);
+		for (size_t i = 0; i < n; i++) {
+			blsSignature sig;
+			blsSign(&sig, &secVec[i], msgPtrVec[i], msgSizeVec[i]);
+			CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sigVec[i]));
+		}
+	}
+	printf("n=%d\n", (int)n);
+	CYBOZU_BENCH_C("signVec", 3, blsSignVec, &sigVec[0], &secVec[0], &msgPtrVec[0], &msgSizeVec[0], n, 1);
+	CYBOZU_BENCH_C("signVecMT", 3, blsSignVec, &sigVec[0], &secVec[0], &msgPtrVec[0], &msgSizeVec[0], n, 0);
+}
+
+void blsBatchVerifyTest()
+{
+	const size_t N = 40;
+	const size_t nTbl[] = { 1, 2, 15, 16, 17, N };
+	blsPublicKey pubVec[N];
+	blsSignature sigVec[N];
+	char msgVec[N * 8];
+	mclSize msgSizeVec[N];
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(nTbl); i++) {
+		const size_t n = nTbl[i];
+		size_t pos = 0;
+		for (size_t j = 0; j < n; j++) {
+			blsSecretKey sec;
+			blsSecretKeySetByCSPRNG(&sec);
+			blsGetPublicKey(&pubVec[j], &sec);
+			// messages of different lengths
+			msgSizeVec[j] = 1 + j % 8;
+			for (size_t k = 0; k < msgSizeVec[j]; k++) {
+				msgVec[pos + k] = char(j + k);
+			}
+			blsSign(&sigVec[j], &sec, &msgVec[pos], msgSizeVec[j]);
+			pos += msgSizeVec[j];
+		}
+		CYBOZU_TEST_EQUAL(blsBatchVerify(sigVec, pubVec, msgVec, msgSizeVec, n), 1);
+		printf("n=%2d ", (int)n);
+		CYBOZU_BENCH_C("batchVerify", 10, blsBatchVerify, sigVec, pubVec, msgVec, msgSizeVec, n);
+		msgVec[pos - 1]++;
+		CYBOZU_TEST_EQUAL(blsBatchVerify(sigVec, pubVec, msgVec, msgSizeVec, n), 0);
+		msgVec[pos - 1]--;
+		if (n > 1) {
+			blsSignature t = sigVec[0];
+			sigVec[0] = sigVec[1];
+			sigVec[1] = t;
+			CYBOZU_TEST_EQUAL(blsBatchVerify(sigVec, pubVec, msgVec, msgSizeVec, n), 0);
+		}
+	}
+	CYBOZU_TEST_EQUAL(blsBatchVerify(sigVec, pubVec, msgVec, msgSizeVec, 0), 0);
+}
+
+#ifndef BLS_SWAP_G
+void blsPublicKeyPrecomputedTest()
+{
+	const size_t n = 5;
+	std::vector<blsPublicKeyPrecomputed> ppubVec(n);
+	blsPublicKey pubVec[n];
+	blsSignature sigVec[n];
+	char msgVec[n][32] = {};
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		CYBOZU_TEST_EQUAL(blsPublicKeyPrecompute(&ppubVec[i], &pubVec[i]), 0);
+		msgVec[i][0] = char(i);
+		blsSign(&sigVec[i], &sec, msgVec[i], sizeof(msgVec[i]));
+		CYBOZU_TEST_EQUAL(blsVerifyPrecomputed(&sigVec[i], &ppubVec[i], msgVec[i], sizeof(msgVec[i])), 1);
+		CYBOZU_TEST_EQUAL(blsVerifyPrecomputed(&sigVec[i], &ppubVec[i], msgVec[i], sizeof(msgVec[i]) - 1), 0);
+	}
+	CYBOZU_BENCH_C("verify", 300, blsVerify, &sigVec[0], &pubVec[0], msgVec[0], sizeof(msgVec[0]));
+	CYBOZU_BENCH_C("verifyPrecomputed", 300, blsVerifyPrecomputed, &sigVec[0], &ppubVec[0], msgVec[0], sizeof(msgVec[0]));
+	for (size_t i = 1; i <= n; i++) {
+		blsSignature aggSig;
+		blsAggregateSignature(&aggSig, sigVec, i);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckPrecomputed(&aggSig, &ppubVec[0], msgVec, sizeof(msgVec[0]), i), 1);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckPrecomputed(&sigVec[0], &ppubVec[0], msgVec, sizeof(msgVec[0]), i), i == 1);
+	}
+}
+#endif
+
+void blsMessageTest()
+{
+	const size_t n = 5;
+	blsSecretKey secVec[n];
+	blsPublicKey pubVec[n];
+	blsSignature sigVec[n];
+	blsMessage msgVec[n];
+	char msg[n][32] = {};
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKeySetByCSPRNG(&secVec[i]);
+		blsGetPublicKey(&pubVec[i], &secVec[i]);
+		msg[i][0] = char(i);
+		CYBOZU_TEST_EQUAL(blsMessageSet(&msgVec[i], msg[i], sizeof(msg[i])), 0);
+		blsSignMessage(&sigVec[i], &secVec[i], &msgVec[i]);
+		blsSignature sig;
+		blsSign(&sig, &secVec[i], msg[i], sizeof(msg[i]));
+		CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sigVec[i]));
+		CYBOZU_TEST_EQUAL(blsVerifyMessage(&sigVec[i], &pubVec[i], &msgVec[i]), 1);
+		CYBOZU_TEST_EQUAL(blsVerifyMessage(&sigVec[i], &pubVec[i], &msgVec[(i + 1) % n]), 0);
+	}
+	CYBOZU_BENCH_C("verify", 300, blsVerify, &sigVec[0], &pubVec[0], msg[0], sizeof(msg[0]));
+	CYBOZU_BENCH_C("verifyMessage", 300, blsVerifyMessage, &sigVec[0], &pubVec[0], &msgVec[0]);
+	// all signatures of msg[0]
+	blsSignature sameSigVec[n];
+	for (size_t i = 0; i < n; i++) {
+		blsSignMessage(&sameSigVec[i], &secVec[i], &msgVec[0]);
+	}
+	for (size_t i = 1; i <= n; i++) {
+		blsSignature aggSig;
+		blsAggregateSignature(&aggSig, sameSigVec, i);
+		CYBOZU_TEST_EQUAL(blsFastAggregateVerifyMessage(&aggSig, pubVec, i, &msgVec[0]), 1);
+		CYBOZU_TEST_EQUAL(blsFastAggregateVerifyMessage(&aggSig, pubVec, i, &msgVec[1]), 0);
+		blsAggregateSignature(&aggSig, sigVec, i);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckMessage(&aggSig, pubVec, msgVec, i), 1);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckMessage(&sigVec[0], pubVec, msgVec, i), i == 1);
+	}
+	CYBOZU_TEST_EQUAL(blsFastAggregateVerifyMessage(&sigVec[0], pubVec, 0, &msgVec[0]), 0);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckMessage(&sigVec[0], pubVec, msgVec, 0), 0);
+}
+
+void blsHashCacheTest()
+{
+	const size_t maxN = 3;
+	if (blsSetHashCacheSize(maxN) != 0) {
+		puts("hash cache is not supported");
+		return;
+	}
+	blsClearHashCache();
+	blsSecretKey sec;
+	blsPublicKey pub;
+	blsSecretKeySetByCSPRNG(&sec);
+	blsGetPublicKey(&pub, &sec);
+	const char *msg = "cached message";
+	const size_t msgSize = strlen(msg);
+	blsSignature sig;
+	blsSign(&sig, &sec, msg, msgSize);
+	for (int i = 0; i < 3; i++) {
+		CYBOZU_TEST_EQUAL(blsVerify(&sig, &pub, msg, msgSize), 1);
+		CYBOZU_TEST_EQUAL(blsVerify(&sig, &pub, msg, msgSize - 1), 0);
+	}
+	uint64_t hitN, missN;
+	mclSize entryN;
+	blsGetHashCacheStats(&hitN, &missN, &entryN);
+	CYBOZU_TEST_EQUAL(hitN, 5u);
+	CYBOZU_TEST_EQUAL(missN, 2u);
+	CYBOZU_TEST_EQUAL(entryN, 2u);
+	// the least recently used entry is evicted
+	for (int i = 0; i < 5; i++) {
+		char m = char(i);
+		blsMessage Hm;
+		blsMessageSet(&Hm, &m, 1);
+	}
+	blsGetHashCacheStats(0, &missN, &entryN);
+	CYBOZU_TEST_EQUAL(missN, 7u);
+	CYBOZU_TEST_EQUAL(entryN, maxN);
+	CYBOZU_TEST_EQUAL(blsVerify(&sig, &pub, msg, msgSize), 1);
+	blsGetHashCacheStats(0, &missN, 0);
+	CYBOZU_TEST_EQUAL(missN, 8u);
+	CYBOZU_BENCH_C("verify with cache", 300, blsVerify, &sig, &pub, msg, msgSize);
+	blsSetHashCacheSize(0);
+	blsClearHashCache();
+	blsGetHashCacheStats(&hitN, &missN, &entryN);
+	CYBOZU_TEST_EQUAL(hitN, 0u);
+	CYBOZU_TEST_EQUAL(missN, 0u);
+	CYBOZU_TEST_EQUAL(entryN, 0u);
+	CYBOZU_TEST_EQUAL(blsVerify(&sig, &pub, msg, msgSize), 1);
+	blsGetHashCacheStats(&hitN, &missN, 0);
+	CYBOZU_TEST_EQUAL(hitN + missN, 0u);
+}
+
+void blsPublicKeyRegistryTest()
+{
+	const size_t N = 10;
+	blsSecretKey secVec[N];
+	blsPublicKey pubVec[N];
+	for (size_t i = 0; i < N; i++) {
+		blsSecretKeySetByCSPRNG(&secVec[i]);
+		blsGetPublicKey(&pubVec[i], &secVec[i]);
+	}
+	blsPublicKeyAffine keyVec[N];
+	blsPublicKeyRegistry reg;
+	CYBOZU_TEST_EQUAL(blsPublicKeyRegistryInit(&reg, keyVec, pubVec, N), 0);
+	CYBOZU_TEST_EQUAL(reg.n, N);
+
+	const uint32_t idxVec[] = { 3, 7, 1, 9, 0, 5 };
+	const size_t n = CYBOZU_NUM_OF_ARRAY(idxVec);
+	blsPublicKey pubs[n];
+	blsSignature sigs[n];
+	const char *msg = "registry";
+	const size_t msgSize = strlen(msg);
+	for (size_t i = 0; i < n; i++) {
+		pubs[i] = pubVec[idxVec[i]];
+		blsSign(&sigs[i], &secVec[idxVec[i]], msg, msgSize);
+	}
+	blsPublicKey aggPub1, aggPub2;
+	aggPub1 = pubs[0];
+	for (size_t i = 1; i < n; i++) {
+		blsPublicKeyAdd(&aggPub1, &pubs[i]);
+	}
+	CYBOZU_TEST_EQUAL(blsAggregatePublicKeyIdx(&aggPub2, &reg, idxVec, n), 0);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&aggPub1, &aggPub2));
+	blsSignature aggSig;
+	blsAggregateSignature(&aggSig, sigs, n);
+	CYBOZU_TEST_EQUAL(blsFastAggregateVerifyIdx(&aggSig, &reg, idxVec, n, msg, msgSize), 1);
+	CYBOZU_TEST_EQUAL(blsFastAggregateVerifyIdx(&aggSig, &reg, idxVec, n - 1, msg, msgSize), 0);
+	CYBOZU_TEST_EQUAL(blsFastAggregateVerifyIdx(&aggSig, &reg, idxVec, 0, msg, msgSize), 0);
+	CYBOZU_BENCH_C("fastAggregateVerify", 100, blsFastAggregateVerify, &aggSig, pubs, n, msg, msgSize);
+	CYBOZU_BENCH_C("fastAggregateVerifyIdx", 100, blsFastAggregateVerifyIdx, &aggSig, &reg, idxVec, n, msg, msgSize);
+
+	char msgVec[n][32] = {};
+	for (size_t i = 0; i < n; i++) {
+		msgVec[i][0] = char(i);
+		blsSign(&sigs[i], &secVec[idxVec[i]], msgVec[i], sizeof(msgVec[i]));
+	}
+	blsAggregateSignature(&aggSig, sigs, n);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckIdx(&aggSig, &reg, idxVec, msgVec, sizeof(msgVec[0]), n), 1);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckIdx(&aggSig, &reg, idxVec + 1, msgVec, sizeof(msgVec[0]), n - 1), 0);
+
+	// out of range
+	const uint32_t badIdxVec[] = { 3, N };
+	CYBOZU_TEST_EQUAL(blsAggregatePublicKeyIdx(&aggPub2, &reg, badIdxVec, 2), -1);
+	CYBOZU_TEST_EQUAL(blsFastAggregateVerifyIdx(&aggSig, &reg, badIdxVec, 2, msg, msgSize), 0);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckIdx(&aggSig, &reg, badIdxVec, msgVec, sizeof(msgVec[0]), 2), 0);
+
+	// zero is not allowed
+	memset(&pubVec[2], 0, sizeof(pubVec[2]));
+	CYBOZU_TEST_EQUAL(blsPublicKeyRegistryInit(&reg, keyVec, pubVec, N), -1);
+	CYBOZU_TEST_EQUAL(reg.n, 0);
+}
+
+void naiveAggregate(blsPublicKey *aggPub, const blsPublicKey *pubVec, size_t n, const uint8_t *bitfield)
+{
+	memset(aggPub, 0, sizeof(*aggPub));
+	for (size_t i = 0; i < n; i++) {
+		if ((bitfield[i / 8] >> (i % 8)) & 1) blsPublicKeyAdd(aggPub, &pubVec[i]);
+	}
+}
+
+// flip the i-th bit and aggregate
+void flipAndAggregate(blsPublicKey *aggPub, blsPublicKeyAggregator *ag, uint8_t *bitfield, size_t i)
+{
+	bitfield[i / 8] ^= uint8_t(1 << (i % 8));
+	blsPublicKeyAggregatorGet(aggPub, ag, bitfield);
+}
+
+void blsPublicKeyAggregatorTest()
+{
+	const size_t n = 100;
+	const size_t bitN = (n + 7) / 8;
+	blsPublicKey pubVec[n];
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+	}
+	blsPublicKey nodeVec[n * 2];
+	uint8_t bitVec[bitN];
+	blsPublicKeyAggregator ag;
+	CYBOZU_TEST_EQUAL(blsPublicKeyAggregatorInit(&ag, nodeVec, bitVec, pubVec, 0), -1);
+	CYBOZU_TEST_EQUAL(blsPublicKeyAggregatorInit(&ag, nodeVec, bitVec, pubVec, n), 0);
+	uint8_t bitfield[bitN] = {};
+	blsPublicKey aggPub1, aggPub2;
+	// direct, complement, incremental
+	const struct {
+		size_t begin;
+		size_t end;
+		bool v;
+	} tbl[] = {
+		{ 3, 20, true },
+		{ 0, n, true },
+		{ 40, 45, false },
+		{ 41, 42, true },
+		{ 90, 91, false },
+		{ 0, n, false },
+		{ 7, 8, true },
+	};
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		for (size_t j = tbl[i].begin; j < tbl[i].end; j++) {
+			if (tbl[i].v) {
+				bitfield[j / 8] |= uint8_t(1 << (j % 8));
+			} else {
+				bitfield[j / 8] &= uint8_t(~(1 << (j % 8)));
+			}
+		}
+		CYBOZU_TEST_EQUAL(blsPublicKeyAggregatorGet(&aggPub1, &ag, bitfield), 0);
+		naiveAggregate(&aggPub2, pubVec, n, bitfield);
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&aggPub1, &aggPub2));
+	}
+	for (size_t i = 0; i < bitN; i++) {
+		bitfield[i] = uint8_t(i * 0x35 + 1);
+	}
+	CYBOZU_TEST_EQUAL(blsPublicKeyAggregatorGet(&aggPub1, &ag, bitfield), 0);
+	naiveAggregate(&aggPub2, pubVec, n, bitfield);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&aggPub1, &aggPub2));
+	CYBOZU_BENCH_C("naiveAggregate", 100, naiveAggregate, &aggPub2, pubVec, n, bitfield);
+	CYBOZU_BENCH_C("aggregatorGet", 100, blsPublicKeyAggregatorGet, &aggPub1, &ag, bitfield);
+	CYBOZU_BENCH_C("aggregatorGet(1bit)", 100, flipAndAggregate, &aggPub1, &ag, bitfield, 30);
+}
+
+void blsDeserializeVecTest()
+{
+	const size_t n = 40;
+	const size_t pubStride = blsGetSerializedPublicKeyByteSize();
+	const size_t sigStride = blsGetSerializedSignatureByteSize();
+	blsPublicKey pubVec[n], pubVec2[n];
+	blsSignature sigVec[n], sigVec2[n];
+	int okVec[n];
+	const size_t maxStride = 128;
+	CYBOZU_TEST_ASSERT(pubStride <= maxStride && sigStride <= maxStride);
+	char pubBuf[maxStride * n], sigBuf[maxStride * n];
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		blsSign(&sigVec[i], &sec, "abc", 3);
+		CYBOZU_TEST_EQUAL(blsPublicKeySerialize(&pubBuf[pubStride * i], pubStride, &pubVec[i]), pubStride);
+		CYBOZU_TEST_EQUAL(blsSignatureSerialize(&sigBuf[sigStride * i], sigStride, &sigVec[i]), sigStride);
+	}
+	const size_t badIdx = 5;
+	memset(&pubBuf[pubStride * badIdx], 0xff, pubStride);
+	memset(&sigBuf[sigStride * badIdx], 0xff, sigStride);
+	for (size_t threadN = 0; threadN <= 4; threadN++) {
+		memset(okVec, 0, sizeof(okVec));
+		CYBOZU_TEST_EQUAL(blsPublicKeyDeserializeVec(pubVec2, okVec, &pubBuf[0], pubStride, n, threadN), n - 1);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_EQUAL(okVec[i], i != badIdx);
+			if (i != badIdx) CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pubVec[i], &pubVec2[i]));
+		}
+		memset(okVec, 0, sizeof(okVec));
+		CYBOZU_TEST_EQUAL(blsSignatureDeserializeVec(sigVec2, okVec, &sigBuf[0], sigStride, n, threadN), n - 1);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_EQUAL(okVec[i], i != badIdx);
+			if (i != badIdx) CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sigVec[i], &sigVec2[i]));
+		}
+	}
+	CYBOZU_TEST_EQUAL(blsPublicKeyDeserializeVec(pubVec2, okVec, &pubBuf[0], pubStride, 0, 0), 0);
+	CYBOZU_BENCH_C("pubDeserializeVec", 10, blsPublicKeyDeserializeVec, pubVec2, okVec, &pubBuf[0], pubStride, n, 1);
+	CYBOZU_BENCH_C("pubDeserializeVecMT", 10, blsPublicKeyDeserializeVec, pubVec2, okVec, &pubBuf[0], pubStride, n, 0);
+	CYBOZU_BENCH_C("sigDeserializeVec", 10, blsSignatureDeserializeVec, sigVec2, okVec, &sigBuf[0], sigStride, n, 1);
+	CYBOZU_BENCH_C("sigDeserializeVecMT", 10, blsSignatureDeserializeVec, sigVec2, okVec, &sigBuf[0], sigStride, n, 0);
+}
+
+void blsNormalizeVecTest()
+{
+	const size_t n = 300;
+	std::vector<blsPublicKey> pubVec(n), pubVec2(n);
+	std::vector<blsSignature> sigVec(n), sigVec2(n);
+	blsSecretKey sec;
+	blsSecretKeySetByCSPRNG(&sec);
+	blsGetPublicKey(&pubVec[0], &sec);
+	blsSign(&sigVec[0], &sec, "abc", 3);
+	for (size_t i = 1; i < n; i++) {
+		pubVec[i] = pubVec[i - 1];
+		blsPublicKeyAdd(&pubVec[i], &pubVec[0]);
+		sigVec[i] = sigVec[i - 1];
+		blsSignatureAdd(&sigVec[i], &sigVec[0]);
+	}
+	memset(&pubVec[5], 0, sizeof(pubVec[5]));
+	memset(&sigVec[130], 0, sizeof(sigVec[130]));
+	for (size_t i = 0; i < n; i++) {
+		pubVec2[i] = pubVec[i];
+		sigVec2[i] = sigVec[i];
+#ifdef BLS_SWAP_G
+		mclBnG1_normalize(&pubVec[i].v, &pubVec[i].v);
+		mclBnG2_normalize(&sigVec[i].v, &sigVec[i].v);
+#else
+		mclBnG2_normalize(&pubVec[i].v, &pubVec[i].v);
+		mclBnG1_normalize(&sigVec[i].v, &sigVec[i].v);
+#endif
+	}
+	// some elements are already normalized
+	pubVec2[7] = pubVec[7];
+	sigVec2[200] = sigVec[200];
+	blsPublicKeyNormalizeVec(&pubVec2[0], n);
+	blsSignatureNormalizeVec(&sigVec2[0], n);
+	for (size_t i = 0; i < n; i++) {
+		CYBOZU_TEST_ASSERT(memcmp(&pubVec[i], &pubVec2[i], sizeof(pubVec[i])) == 0);
+		CYBOZU_TEST_ASSERT(memcmp(&sigVec[i], &sigVec2[i], sizeof(sigVec[i])) == 0);
+	}
+	for (size_t i = 1; i < n; i++) {
+		blsPublicKeyAdd(&pubVec2[i], &pubVec[0]);
+	}
+	CYBOZU_BENCH_C("pubNormalizeVec", 10, blsPublicKeyNormalizeVec, &pubVec2[0], n);
+}
+
+template<class T>
+void serializeVecTestOne(const T *xVec, size_t n, mclSize (*f)(void *, mclSize, const T *), mclSize (*fVec)(void *, mclSize, const T *, mclSize, mclSize))
+{
+	const size_t stride = 200;
+	const size_t maxN = 80;
+	char buf1[stride * maxN] = {}, buf2[stride * maxN] = {};
+	bool ok = true;
+	for (size_t i = 0; i < n; i++) {
+		if (f(&buf1[stride * i], stride, &xVec[i]) == 0) ok = false;
+	}
+	for (size_t threadN = 0; threadN <= 4; threadN++) {
+		memset(buf2, 0, sizeof(buf2));
+		CYBOZU_TEST_EQUAL(fVec(buf2, stride, xVec, n, threadN), ok ? n * stride : 0);
+		if (ok) CYBOZU_TEST_ASSERT(memcmp(buf1, buf2, stride * n) == 0);
+	}
+	// too small stride
+	CYBOZU_TEST_EQUAL(fVec(buf2, 1, xVec, n, 1), 0);
+	CYBOZU_BENCH_C("serialize", 10, f, buf1, stride, xVec);
+	CYBOZU_BENCH_C("serializeVec(n=80)", 10, fVec, buf2, stride, xVec, n, 1);
+}
+
+void blsSerializeVecTest()
+{
+	const size_t n = 80;
+	blsPublicKey pubVec[n];
+	blsSignature sigVec[n];
+	blsSecretKey sec;
+	blsSecretKeySetByCSPRNG(&sec);
+	blsGetPublicKey(&pubVec[0], &sec);
+	blsSign(&sigVec[0], &sec, "abc", 3);
+	for (size_t i = 1; i < n; i++) {
+		pubVec[i] = pubVec[i - 1];
+		blsPublicKeyAdd(&pubVec[i], &pubVec[0]);
+		sigVec[i] = sigVec[i - 1];
+		blsSignatureAdd(&sigVec[i], &sigVec[0]);
+	}
+	serializeVecTestOne(pubVec, n, blsPublicKeySerialize, blsPublicKeySerializeVec);
+	serializeVecTestOne(sigVec, n, blsSignatureSerialize, blsSignatureSerializeVec);
+	serializeVecTestOne(pubVec, n, blsPublicKeySerializeUncompressed, blsPublicKeySerializeUncompressedVec);
+	serializeVecTestOne(sigVec, n, blsSignatureSerializeUncompressed, blsSignatureSerializeUncompressedVec);
+}
+
 void blsMultiAggregateTest()
 {
 	const size_t N = 40;
@@ -377,6 +875,646 @@ void blsMultiAggregateTest()
 	}
 }
 
+// pubVec[i] = (i + 1) pub and sigVec[i] = (i + 1) sig of one key pair for i = 0, ..., n - 1
+void makeMultiAggregateVec(std::vector<blsPublicKey>& pubVec, std::vector<blsSignature>& sigVec, size_t n, const char *msg, size_t msgSize)
+{
+	pubVec.resize(n);
+	sigVec.resize(n);
+	blsSecretKey sec;
+	blsSecretKeySetByCSPRNG(&sec);
+	blsGetPublicKey(&pubVec[0], &sec);
+	blsSign(&sigVec[0], &sec, msg, msgSize);
+	for (size_t i = 1; i < n; i++) {
+		pubVec[i] = pubVec[i - 1];
+		blsPublicKeyAdd(&pubVec[i], &pubVec[0]);
+		sigVec[i] = sigVec[i - 1];
+		blsSignatureAdd(&sigVec[i], &sigVec[0]);
+	}
+}
+
+void blsMultiAggregateMTTest()
+{
+	const size_t n = 300;
+	std::vector<blsPublicKey> pubVec;
+	std::vector<blsSignature> sigVec;
+	const char *msg = "abcdefg";
+	const size_t msgSize = strlen(msg);
+	makeMultiAggregateVec(pubVec, sigVec, n, msg, msgSize);
+	blsPublicKey aggPub1, aggPub2;
+	blsSignature aggSig1, aggSig2;
+	// the bucket method for n = 300
+	blsMultiAggregatePublicKey(&aggPub1, &pubVec[0], n);
+	blsMultiAggregateSignature(&aggSig1, &sigVec[0], &pubVec[0], n);
+	CYBOZU_TEST_ASSERT(blsVerify(&aggSig1, &aggPub1, msg, msgSize));
+	// each thread uses mulVec for n = 75
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(threadTbl); i++) {
+		blsMultiAggregatePublicKeyMT(&aggPub2, &pubVec[0], n, threadTbl[i]);
+		blsMultiAggregateSignatureMT(&aggSig2, &sigVec[0], &pubVec[0], n, threadTbl[i]);
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&aggPub1, &aggPub2));
+		CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&aggSig1, &aggSig2));
+	}
+}
+
+void blsSha256TestOne(int mode, const unsigned char *mdTbl, const blsPublicKey& aggPub, const blsSignature& aggSig, blsPublicKey *pubVec, blsSignature *sigVec, size_t n)
+{
+	const size_t maxMsgSize = 200;
+	char msg[maxMsgSize];
+	for (size_t i = 0; i < maxMsgSize; i++) {
+		msg[i] = char(i * 7 + 1);
+	}
+	CYBOZU_TEST_EQUAL(blsSetSha256Mode(mode), 0);
+	CYBOZU_TEST_EQUAL(blsGetSha256Mode(), mode);
+	for (size_t i = 0; i < maxMsgSize; i++) {
+		unsigned char md[32];
+		CYBOZU_TEST_EQUAL(blsSha256(md, sizeof(md), msg, i), 32);
+		CYBOZU_TEST_EQUAL_ARRAY(md, &mdTbl[i * 32], 32);
+	}
+	blsPublicKey aggPub2;
+	blsSignature aggSig2;
+	blsMultiAggregatePublicKey(&aggPub2, pubVec, n);
+	blsMultiAggregateSignature(&aggSig2, sigVec, pubVec, n);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&aggPub, &aggPub2));
+	CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&aggSig, &aggSig2));
+	printf("sha256 mode=%d\n", mode);
+	CYBOZU_BENCH_C("sha256(64)", 1000, blsSha256, msg, 32, msg, 64);
+	CYBOZU_BENCH_C("multiAggPub", 10, blsMultiAggregatePublicKey, &aggPub2, pubVec, n);
+}
+
+void blsSha256Test()
+{
+	const struct {
+		const char *msg;
+		const char *md;
+	} tbl[] = {
+		{ "", "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855" },
+		{ "abc", "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad" },
+		{ "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1" },
+	};
+	const int curMode = blsGetSha256Mode();
+	CYBOZU_TEST_EQUAL(blsGetSha256SupportedMode() & curMode, curMode);
+	CYBOZU_TEST_EQUAL(blsSetSha256Mode(0), 0);
+	unsigned char md[32];
+	CYBOZU_TEST_EQUAL(blsSha256(md, sizeof(md) - 1, "abc", 3), 0);
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(tbl); i++) {
+		CYBOZU_TEST_EQUAL(blsSha256(md, sizeof(md), tbl[i].msg, strlen(tbl[i].msg)), 32);
+		char hex[65];
+		for (size_t j = 0; j < 32; j++) {
+			hex[j * 2] = "0123456789abcdef"[md[j] >> 4];
+			hex[j * 2 + 1] = "0123456789abcdef"[md[j] & 15];
+		}
+		hex[64] = '\0';
+		CYBOZU_TEST_ASSERT(strcmp(hex, tbl[i].md) == 0);
+	}
+	// the outputs of the portable implementation
+	const size_t maxMsgSize = 200;
+	std::vector<unsigned char> mdTbl(maxMsgSize * 32);
+	char msg[maxMsgSize];
+	for (size_t i = 0; i < maxMsgSize; i++) {
+		msg[i] = char(i * 7 + 1);
+	}
+	for (size_t i = 0; i < maxMsgSize; i++) {
+		blsSha256(&mdTbl[i * 32], 32, msg, i);
+	}
+	const size_t n = 300;
+	std::vector<blsPublicKey> pubVec;
+	std::vector<blsSignature> sigVec;
+	makeMultiAggregateVec(pubVec, sigVec, n, "abc", 3);
+	blsPublicKey aggPub;
+	blsSignature aggSig;
+	blsMultiAggregatePublicKey(&aggPub, &pubVec[0], n);
+	blsMultiAggregateSignature(&aggSig, &sigVec[0], &pubVec[0], n);
+	const int modeTbl[] = { 0, BLS_SHA256_SHA_NI, BLS_SHA256_AVX2, BLS_SHA256_SHA_NI | BLS_SHA256_AVX2 };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(modeTbl); i++) {
+		const int mode = modeTbl[i];
+		if ((blsGetSha256SupportedMode() & mode) != mode) {
+			CYBOZU_TEST_EQUAL(blsSetSha256Mode(mode), -1);
+			continue;
+		}
+		blsSha256TestOne(mode, &mdTbl[0], aggPub, aggSig, &pubVec[0], &sigVec[0], n);
+	}
+	CYBOZU_TEST_EQUAL(blsSetSha256Mode(curMode), 0);
+}
+
+void blsStatsTest()
+{
+	blsStats stats;
+	char buf[1024];
+	blsResetStats();
+	blsSecretKey sec;
+	blsPublicKey pub;
+	blsSignature sig;
+	const char msg[] = "stats";
+	blsSecretKeySetByCSPRNG(&sec);
+	blsGetPublicKey(&pub, &sec);
+	blsSign(&sig, &sec, msg, strlen(msg));
+	const mclSize sigSize = blsSignatureSerialize(buf, sizeof(buf), &sig);
+	CYBOZU_TEST_ASSERT(sigSize > 0);
+	CYBOZU_TEST_EQUAL(blsSignatureDeserialize(&sig, buf, sigSize), sigSize);
+	CYBOZU_TEST_ASSERT(blsSignatureIsValidOrder(&sig));
+	CYBOZU_TEST_ASSERT(blsVerify(&sig, &pub, msg, strlen(msg)));
+#ifdef BLS_USE_STATS
+	CYBOZU_TEST_EQUAL(blsGetStats(&stats), 0);
+	for (int i = 0; i < BLS_STATS_N; i++) {
+		CYBOZU_TEST_ASSERT(stats.callN[i] > 0);
+	}
+	const mclSize n = blsGetStatsText(buf, sizeof(buf));
+	CYBOZU_TEST_ASSERT(n > 0);
+	CYBOZU_TEST_EQUAL(strlen(buf), n);
+	CYBOZU_TEST_ASSERT(strstr(buf, "bls_calls_total{phase=\"miller_loop\"}") != 0);
+	CYBOZU_TEST_EQUAL(blsGetStatsText(buf, 10), 0);
+	blsResetStats();
+	CYBOZU_TEST_EQUAL(blsGetStats(&stats), 0);
+	for (int i = 0; i < BLS_STATS_N; i++) {
+		CYBOZU_TEST_EQUAL(stats.callN[i], 0u);
+	}
+#else
+	CYBOZU_TEST_EQUAL(blsGetStats(&stats), -1);
+	for (int i = 0; i < BLS_STATS_N; i++) {
+		CYBOZU_TEST_EQUAL(stats.callN[i], 0u);
+	}
+	CYBOZU_TEST_EQUAL(blsGetStatsText(buf, sizeof(buf)), 0);
+#endif
+}
+
+int aggVerifyByContext(const blsSignature *sig, const blsPublicKey *pubVec, const void *const *msgPtrVec, const mclSize *msgSizeVec, size_t n)
+{
+	blsAggVerifyContext ctx;
+	blsAggVerifyInit(&ctx, sig);
+	for (size_t i = 0; i < n; i++) {
+		blsAggVerifyUpdate(&ctx, &pubVec[i], msgPtrVec[i], msgSizeVec[i]);
+	}
+	return blsAggVerifyFinal(&ctx);
+}
+
+void blsAggVerifyTest()
+{
+	const size_t n = 20;
+	const size_t maxMsgSize = 64;
+	char msgVec[n][maxMsgSize];
+	size_t msgSizeVec[n];
+	blsPublicKey pubVec[n];
+	blsSignature aggSig, partSig[3];
+	memset(partSig, 0, sizeof(partSig));
+	for (size_t i = 0; i < n; i++) {
+		// different sizes
+		msgSizeVec[i] = i * 3 + 1;
+		for (size_t j = 0; j < msgSizeVec[i]; j++) {
+			msgVec[i][j] = char(i * 11 + j);
+		}
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		blsSignature sig;
+		blsSign(&sig, &sec, msgVec[i], msgSizeVec[i]);
+		if (i == 0) {
+			aggSig = sig;
+		} else {
+			blsSignatureAdd(&aggSig, &sig);
+		}
+		blsSignatureAdd(&partSig[i % 3], &sig);
+	}
+	blsAggVerifyContext ctx;
+	blsAggVerifyInit(&ctx, &aggSig);
+	CYBOZU_TEST_ASSERT(!blsAggVerifyFinal(&ctx));
+	for (size_t i = 0; i < n; i++) {
+		blsAggVerifyUpdate(&ctx, &pubVec[i], msgVec[i], msgSizeVec[i]);
+	}
+	CYBOZU_TEST_ASSERT(blsAggVerifyFinal(&ctx));
+	// a wrong message
+	blsAggVerifyInit(&ctx, &aggSig);
+	for (size_t i = 0; i < n; i++) {
+		blsAggVerifyUpdate(&ctx, &pubVec[i], msgVec[i], msgSizeVec[i] - (i == 5));
+	}
+	CYBOZU_TEST_ASSERT(!blsAggVerifyFinal(&ctx));
+	// a missing pair
+	blsAggVerifyInit(&ctx, &aggSig);
+	for (size_t i = 1; i < n; i++) {
+		blsAggVerifyUpdate(&ctx, &pubVec[i], msgVec[i], msgSizeVec[i]);
+	}
+	CYBOZU_TEST_ASSERT(!blsAggVerifyFinal(&ctx));
+	// merge contexts which have no signature
+	blsAggVerifyContext ctxVec[3];
+	blsAggVerifyInit(&ctx, &aggSig);
+	for (size_t i = 0; i < 3; i++) {
+		blsAggVerifyInit(&ctxVec[i], 0);
+	}
+	for (size_t i = 0; i < n; i++) {
+		blsAggVerifyUpdate(&ctxVec[i % 3], &pubVec[i], msgVec[i], msgSizeVec[i]);
+	}
+	for (size_t i = 0; i < 3; i++) {
+		blsAggVerifyMerge(&ctx, &ctxVec[i]);
+	}
+	CYBOZU_TEST_ASSERT(blsAggVerifyFinal(&ctx));
+	// merge contexts which have a part of the signature
+	for (size_t i = 0; i < 3; i++) {
+		blsAggVerifyInit(&ctxVec[i], &partSig[i]);
+	}
+	for (size_t i = 0; i < n; i++) {
+		blsAggVerifyUpdate(&ctxVec[i % 3], &pubVec[i], msgVec[i], msgSizeVec[i]);
+	}
+	CYBOZU_TEST_ASSERT(!blsAggVerifyFinal(&ctxVec[0]));
+	blsAggVerifyInit(&ctx, 0);
+	for (size_t i = 0; i < 3; i++) {
+		blsAggVerifyMerge(&ctx, &ctxVec[i]);
+	}
+	CYBOZU_TEST_ASSERT(blsAggVerifyFinal(&ctx));
+	CYBOZU_BENCH_C("aggVerifyUpdate", 10, blsAggVerifyUpdate, &ctx, &pubVec[0], msgVec[0], msgSizeVec[0]);
+	const void *msgPtrVec[n];
+	mclSize msgSizeVec2[n];
+	for (size_t i = 0; i < n; i++) {
+		msgPtrVec[i] = msgVec[i];
+		msgSizeVec2[i] = msgSizeVec[i];
+	}
+	CYBOZU_TEST_EQUAL(aggVerifyByContext(&aggSig, pubVec, msgPtrVec, msgSizeVec2, n), 1);
+	CYBOZU_BENCH_C("aggVerifyByContext", 10, aggVerifyByContext, &aggSig, pubVec, msgPtrVec, msgSizeVec2, n);
+#ifdef BLS_ETH
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckPtr(&aggSig, pubVec, msgPtrVec, msgSizeVec2, n), 1);
+	CYBOZU_BENCH_C("aggVerifyNoCheckPtr", 10, blsAggregateVerifyNoCheckPtr, &aggSig, pubVec, msgPtrVec, msgSizeVec2, n);
+#endif
+}
+
+void blsPtrVerifyTest()
+{
+	const size_t n = 10;
+	const size_t maxMsgSize = 32;
+	// messages in separate buffers of different sizes
+	char msgBuf[n][maxMsgSize];
+	const void *msgPtrVec[n];
+	mclSize msgSizeVec[n];
+	char packedMsg[n * 8];
+	blsPublicKey pubVec[n];
+	blsSignature sigVec[n], hSigVec[n], aggSig, hAggSig;
+	bool hashOk = true;
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		msgSizeVec[i] = 8 + i;
+		for (size_t j = 0; j < maxMsgSize; j++) {
+			msgBuf[i][j] = char(i * 5 + j);
+		}
+		memcpy(&packedMsg[i * 8], msgBuf[i], 8);
+		msgPtrVec[i] = msgBuf[i];
+		blsSign(&sigVec[i], &sec, msgBuf[i], msgSizeVec[i]);
+		// blsSignHash may not accept a hash of maxMsgSize bytes in some modes
+		if (blsSignHash(&hSigVec[i], &sec, msgBuf[i], maxMsgSize) != 0) hashOk = false;
+	}
+	blsAggregateSignature(&aggSig, sigVec, n);
+	blsAggregateSignature(&hAggSig, hSigVec, n);
+#ifndef MCL_DONT_USE_CSPRNG
+	CYBOZU_TEST_EQUAL(blsBatchVerifyPtr(sigVec, pubVec, msgPtrVec, msgSizeVec, n), 1);
+	msgBuf[3][0]++;
+	CYBOZU_TEST_EQUAL(blsBatchVerifyPtr(sigVec, pubVec, msgPtrVec, msgSizeVec, n), 0);
+	msgBuf[3][0]--;
+	CYBOZU_BENCH_C("batchVerifyPtr", 10, blsBatchVerifyPtr, sigVec, pubVec, msgPtrVec, msgSizeVec, n);
+#endif
+	// the same result as the packed version for messages of the same size
+	mclSize sizeVec8[n];
+	for (size_t i = 0; i < n; i++) {
+		sizeVec8[i] = 8;
+	}
+	for (int mod = 0; mod < 2; mod++) {
+		msgBuf[n - 1][0] += char(mod);
+		packedMsg[(n - 1) * 8] += char(mod);
+		const int ok = blsAggregateVerifyNoCheck(&aggSig, pubVec, packedMsg, 8, n);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckPtr(&aggSig, pubVec, msgPtrVec, sizeVec8, n), ok);
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckPtrMT(&aggSig, pubVec, msgPtrVec, sizeVec8, n, 0), ok);
+	}
+	msgBuf[n - 1][0]--;
+	// hashes
+	mclSize hSizeVec[n];
+	char packedHash[n * maxMsgSize];
+	for (size_t i = 0; i < n; i++) {
+		hSizeVec[i] = maxMsgSize;
+		memcpy(&packedHash[i * maxMsgSize], msgBuf[i], maxMsgSize);
+	}
+	if (hashOk) {
+		CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashes(&hAggSig, pubVec, packedHash, maxMsgSize, n), 1);
+		CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashesPtr(&hAggSig, pubVec, msgPtrVec, hSizeVec, n), 1);
+		CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashesPtrMT(&hAggSig, pubVec, msgPtrVec, hSizeVec, n, 0), 1);
+	}
+	CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashesPtr(&aggSig, pubVec, msgPtrVec, hSizeVec, n), 0);
+	// hash with domain (valid only for BLS12-381 with BLS_ETH)
+	unsigned char hwdBuf[n][48];
+	unsigned char hashWithDomain[n][40];
+	const unsigned char *hashWithDomainPtrVec[n];
+	blsSignature hwdAggSig;
+	memset(&hwdAggSig, 0, sizeof(hwdAggSig));
+	bool signOk = true;
+	for (size_t i = 0; i < n; i++) {
+		for (size_t j = 0; j < 40; j++) {
+			hwdBuf[i][j] = (unsigned char)(i * 3 + j);
+		}
+		memcpy(hashWithDomain[i], hwdBuf[i], 40);
+		hashWithDomainPtrVec[i] = hwdBuf[i];
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		blsSignature sig;
+		if (blsSignHashWithDomain(&sig, &sec, hwdBuf[i]) == 0) {
+			blsSignatureAdd(&hwdAggSig, &sig);
+		} else {
+			signOk = false;
+		}
+	}
+	const int ok = blsVerifyAggregatedHashWithDomain(&hwdAggSig, pubVec, hashWithDomain, n);
+	if (signOk) CYBOZU_TEST_EQUAL(ok, 1);
+	CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashWithDomainPtr(&hwdAggSig, pubVec, hashWithDomainPtrVec, n), ok);
+	CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashWithDomainPtrMT(&hwdAggSig, pubVec, hashWithDomainPtrVec, n, 0), ok);
+	hwdBuf[1][0]++;
+	CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashWithDomainPtr(&hwdAggSig, pubVec, hashWithDomainPtrVec, n), 0);
+}
+
+void blsAggregateVerifyGroupByMessageTest()
+{
+	const size_t n = 64;
+	const size_t msgN = 5;
+	const size_t msgSize = 8;
+	// msgN distinct messages of different sizes
+	char msgTbl[msgN][msgSize * 2];
+	for (size_t i = 0; i < msgN; i++) {
+		for (size_t j = 0; j < sizeof(msgTbl[i]); j++) {
+			msgTbl[i][j] = char(i * 3 + j);
+		}
+	}
+	blsPublicKey pubVec[n];
+	blsSignature aggSig, aggSig2;
+	char msgVec[n * msgSize];
+	const void *msgPtrVec[n];
+	mclSize msgSizeVec[n];
+	for (size_t i = 0; i < n; i++) {
+		const size_t k = (i * 7) % msgN;
+		blsSecretKey sec;
+		blsSecretKeySetByCSPRNG(&sec);
+		blsGetPublicKey(&pubVec[i], &sec);
+		memcpy(&msgVec[i * msgSize], msgTbl[k], msgSize);
+		msgPtrVec[i] = msgTbl[k];
+		msgSizeVec[i] = msgSize + k;
+		blsSignature sig, sig2;
+		blsSign(&sig, &sec, &msgVec[i * msgSize], msgSize);
+		blsSign(&sig2, &sec, msgPtrVec[i], msgSizeVec[i]);
+		if (i == 0) {
+			aggSig = sig;
+			aggSig2 = sig2;
+		} else {
+			blsSignatureAdd(&aggSig, &sig);
+			blsSignatureAdd(&aggSig2, &sig2);
+		}
+	}
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessage(&aggSig, pubVec, msgVec, msgSize, n), 1);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessagePtr(&aggSig2, pubVec, msgPtrVec, msgSizeVec, n), 1);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessage(&aggSig, pubVec, msgVec, msgSize, 0), 0);
+	// the same result as the pair-by-pair verification
+	CYBOZU_TEST_EQUAL(aggVerifyByContext(&aggSig2, pubVec, msgPtrVec, msgSizeVec, n), 1);
+	// pubVec[0] and pubVec[1] have different messages
+	blsPublicKey t = pubVec[0];
+	pubVec[0] = pubVec[1];
+	pubVec[1] = t;
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessage(&aggSig, pubVec, msgVec, msgSize, n), 0);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessagePtr(&aggSig2, pubVec, msgPtrVec, msgSizeVec, n), 0);
+	pubVec[1] = pubVec[0];
+	pubVec[0] = t;
+	// the same bytes with a different size are different messages
+	msgSizeVec[0]++;
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyGroupByMessagePtr(&aggSig2, pubVec, msgPtrVec, msgSizeVec, n), 0);
+	msgSizeVec[0]--;
+	CYBOZU_BENCH_C("aggVerifyGroupByMsg", 10, blsAggregateVerifyGroupByMessagePtr, &aggSig2, pubVec, msgPtrVec, msgSizeVec, n);
+	// the pair-by-pair verification computes a hash-to-curve and a Miller loop for every pair
+	CYBOZU_BENCH_C("aggVerifyByContext", 10, aggVerifyByContext, &aggSig2, pubVec, msgPtrVec, msgSizeVec, n);
+#ifdef BLS_ETH
+	CYBOZU_BENCH_C("aggVerifyNoCheckPtr", 10, blsAggregateVerifyNoCheckPtr, &aggSig2, pubVec, msgPtrVec, msgSizeVec, n);
+#endif
+}
+
+void blsRecoveryPlanTest()
+{
+	const size_t k = 5;
+	const size_t n = 8;
+	const char *msg = "abc";
+	const size_t msgSize = strlen(msg);
+	blsSecretKey msk[k];
+	blsPublicKey mpk[k];
+	for (size_t i = 0; i < k; i++) {
+		blsSecretKeySetByCSPRNG(&msk[i]);
+		blsGetPublicKey(&mpk[i], &msk[i]);
+	}
+	blsSecretKey secVec[n];
+	blsPublicKey pubVec[n];
+	blsSignature sigVec[n];
+	blsId idVec[n];
+	for (size_t i = 0; i < n; i++) {
+		blsIdSetInt(&idVec[i], int(i * 5 + 3));
+		CYBOZU_TEST_EQUAL(blsSecretKeyShare(&secVec[i], msk, k, &idVec[i]), 0);
+		CYBOZU_TEST_EQUAL(blsPublicKeyShare(&pubVec[i], mpk, k, &idVec[i]), 0);
+		blsSign(&sigVec[i], &secVec[i], msg, msgSize);
+	}
+	blsSignature sig0;
+	blsSign(&sig0, &msk[0], msg, msgSize);
+	mclBnFr coeffVec[n];
+	blsRecoveryPlan plan;
+	// k-of-n by the last k shares
+	CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, &idVec[n - k], k), 0);
+	blsSecretKey sec, sec2;
+	blsPublicKey pub, pub2;
+	blsSignature sig, sig2;
+	CYBOZU_TEST_EQUAL(blsSecretKeyRecoverByPlan(&sec, &secVec[n - k], &plan), 0);
+	CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&sec, &msk[0]));
+	CYBOZU_TEST_EQUAL(blsPublicKeyRecoverByPlan(&pub, &pubVec[n - k], &plan), 0);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &mpk[0]));
+	CYBOZU_TEST_EQUAL(blsSignatureRecoverByPlan(&sig, &sigVec[n - k], &plan), 0);
+	CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sig0));
+	// the same result as the non-plan version for any n
+	for (size_t m = 1; m <= n; m++) {
+		CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, idVec, m), 0);
+		blsSecretKeyRecoverByPlan(&sec, secVec, &plan);
+		blsPublicKeyRecoverByPlan(&pub, pubVec, &plan);
+		blsSignatureRecoverByPlan(&sig, sigVec, &plan);
+		CYBOZU_TEST_EQUAL(blsSecretKeyRecover(&sec2, secVec, idVec, m), 0);
+		CYBOZU_TEST_EQUAL(blsPublicKeyRecover(&pub2, pubVec, idVec, m), 0);
+		CYBOZU_TEST_EQUAL(blsSignatureRecover(&sig2, sigVec, idVec, m), 0);
+		CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&sec, &sec2));
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &pub2));
+		CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sig2));
+		CYBOZU_TEST_EQUAL(blsSignatureIsEqual(&sig, &sig0), m >= k);
+	}
+	// n = 1 returns the same value
+	CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, &idVec[2], 1), 0);
+	blsSignatureRecoverByPlan(&sig, &sigVec[2], &plan);
+	CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sigVec[2]));
+	// n = 0, the same ids and a zero id are errors
+	CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, idVec, 0), -1);
+	blsId badIdVec[3] = { idVec[0], idVec[1], idVec[0] };
+	CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, badIdVec, 3), -1);
+	blsIdSetInt(&badIdVec[2], 0);
+	CYBOZU_TEST_EQUAL(blsRecoveryPlanInit(&plan, coeffVec, badIdVec, 3), -1);
+}
+
+void blsLargeRecoverTest()
+{
+	const size_t n = 200;
+	const char *msg = "abc";
+	const size_t msgSize = strlen(msg);
+	std::vector<blsSecretKey> msk(n), secVec(n);
+	std::vector<blsPublicKey> pubVec(n);
+	std::vector<blsSignature> sigVec(n);
+	std::vector<blsId> idVec(n);
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKeySetByCSPRNG(&msk[i]);
+	}
+	for (size_t i = 0; i < n; i++) {
+		blsIdSetInt(&idVec[i], int(i * 7 + 1));
+		CYBOZU_TEST_EQUAL(blsSecretKeyShare(&secVec[i], &msk[0], n, &idVec[i]), 0);
+		blsGetPublicKey(&pubVec[i], &secVec[i]);
+		blsSign(&sigVec[i], &secVec[i], msg, msgSize);
+	}
+	blsPublicKey pub0;
+	blsSignature sig0;
+	blsGetPublicKey(&pub0, &msk[0]);
+	blsSign(&sig0, &msk[0], msg, msgSize);
+	// n-of-n by LagrangeInterpolation
+	blsSecretKey sec;
+	blsPublicKey pub;
+	blsSignature sig;
+	CYBOZU_TEST_EQUAL(blsSecretKeyRecover(&sec, &secVec[0], &idVec[0], n), 0);
+	CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&sec, &msk[0]));
+	CYBOZU_TEST_EQUAL(blsPublicKeyRecover(&pub, &pubVec[0], &idVec[0], n), 0);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &pub0));
+	CYBOZU_TEST_EQUAL(blsSignatureRecover(&sig, &sigVec[0], &idVec[0], n), 0);
+	CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sig0));
+	// by the batch inversion and the bucket method
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(threadTbl); i++) {
+		const size_t threadN = threadTbl[i];
+		CYBOZU_TEST_EQUAL(blsSecretKeyRecoverMT(&sec, &secVec[0], &idVec[0], n, threadN), 0);
+		CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&sec, &msk[0]));
+		CYBOZU_TEST_EQUAL(blsPublicKeyRecoverMT(&pub, &pubVec[0], &idVec[0], n, threadN), 0);
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &pub0));
+		CYBOZU_TEST_EQUAL(blsSignatureRecoverMT(&sig, &sigVec[0], &idVec[0], n, threadN), 0);
+		CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sig0));
+	}
+	// the same value as the single version around the threshold of the bucket method
+	const size_t mTbl[] = { 1, 2, 127, 128, 129 };
+	for (size_t i = 0; i < CYBOZU_NUM_OF_ARRAY(mTbl); i++) {
+		const size_t m = mTbl[i];
+		blsPublicKey pub2;
+		blsSignature sig2;
+		CYBOZU_TEST_EQUAL(blsPublicKeyRecover(&pub, &pubVec[0], &idVec[0], m), 0);
+		CYBOZU_TEST_EQUAL(blsPublicKeyRecoverMT(&pub2, &pubVec[0], &idVec[0], m, 1), 0);
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &pub2));
+		CYBOZU_TEST_EQUAL(blsSignatureRecover(&sig, &sigVec[0], &idVec[0], m), 0);
+		CYBOZU_TEST_EQUAL(blsSignatureRecoverMT(&sig2, &sigVec[0], &idVec[0], m, 1), 0);
+		CYBOZU_TEST_ASSERT(blsSignatureIsEqual(&sig, &sig2));
+	}
+	// n - 1 shares can't recover
+	CYBOZU_TEST_EQUAL(blsSignatureRecover(&sig, &sigVec[0], &idVec[0], n - 1), 0);
+	CYBOZU_TEST_ASSERT(!blsSignatureIsEqual(&sig, &sig0));
+	// the same ids
+	idVec[n - 1] = idVec[0];
+	CYBOZU_TEST_EQUAL(blsSignatureRecover(&sig, &sigVec[0], &idVec[0], n), -1);
+	CYBOZU_TEST_EQUAL(blsSignatureRecoverMT(&sig, &sigVec[0], &idVec[0], n, 0), -1);
+}
+
+void blsShareVecTest()
+{
+	const size_t k = 7;
+	const size_t n = 100;
+	blsSecretKey msk[k];
+	blsPublicKey mpk[k];
+	for (size_t i = 0; i < k; i++) {
+		blsSecretKeySetByCSPRNG(&msk[i]);
+		blsGetPublicKey(&mpk[i], &msk[i]);
+	}
+	blsId idVec[n];
+	blsSecretKey secVec1[n], secVec2[n];
+	blsPublicKey pubVec1[n], pubVec2[n];
+	for (size_t i = 0; i < n; i++) {
+		blsIdSetInt(&idVec[i], int(i * 3 + 1));
+		CYBOZU_TEST_EQUAL(blsSecretKeyShare(&secVec1[i], msk, k, &idVec[i]), 0);
+		CYBOZU_TEST_EQUAL(blsPublicKeyShare(&pubVec1[i], mpk, k, &idVec[i]), 0);
+	}
+	for (size_t t = 0; t < CYBOZU_NUM_OF_ARRAY(threadTbl); t++) {
+		const size_t threadN = threadTbl[t];
+		for (size_t m = 1; m <= k; m++) {
+			CYBOZU_TEST_EQUAL(blsSecretKeyShareVec(secVec2, msk, m, idVec, n, threadN), 0);
+			for (size_t i = 0; i < n; i++) {
+				blsSecretKey sec;
+				blsSecretKeyShare(&sec, msk, m, &idVec[i]);
+				CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&secVec2[i], &sec));
+			}
+		}
+		CYBOZU_TEST_EQUAL(blsPublicKeyShareVec(pubVec2, mpk, k, idVec, n, threadN), 0);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&secVec1[i], &secVec2[i]));
+			CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pubVec1[i], &pubVec2[i]));
+		}
+		// k = 1 is constant
+		CYBOZU_TEST_EQUAL(blsPublicKeyShareVec(pubVec2, mpk, 1, idVec, n, threadN), 0);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pubVec2[i], &mpk[0]));
+		}
+	}
+	CYBOZU_TEST_EQUAL(blsSecretKeyShareVec(secVec2, msk, 0, idVec, n, 1), -1);
+	CYBOZU_TEST_EQUAL(blsPublicKeyShareVec(pubVec2, mpk, 0, idVec, n, 1), -1);
+	// the shares recover the master keys
+	CYBOZU_TEST_EQUAL(blsSecretKeyShareVec(secVec2, msk, k, idVec, n, 0), 0);
+	CYBOZU_TEST_EQUAL(blsPublicKeyShareVec(pubVec2, mpk, k, idVec, n, 0), 0);
+	blsSecretKey sec;
+	blsPublicKey pub;
+	CYBOZU_TEST_EQUAL(blsSecretKeyRecover(&sec, &secVec2[n - k], &idVec[n - k], k), 0);
+	CYBOZU_TEST_ASSERT(blsSecretKeyIsEqual(&sec, &msk[0]));
+	CYBOZU_TEST_EQUAL(blsPublicKeyRecover(&pub, &pubVec2[n - k], &idVec[n - k], k), 0);
+	CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pub, &mpk[0]));
+	CYBOZU_BENCH_C("pubShare", 10, blsPublicKeyShare, &pubVec1[0], mpk, k, &idVec[0]);
+	CYBOZU_BENCH_C("pubShareVec", 10, blsPublicKeyShareVec, pubVec2, mpk, k, idVec, n, 1);
+	CYBOZU_BENCH_C("pubShareVecMT", 10, blsPublicKeyShareVec, pubVec2, mpk, k, idVec, n, 0);
+}
+
+void mulGeneratorOfPublicKey(blsPublicKey *pub, const blsSecretKey *sec)
+{
+	blsPublicKey gen;
+	blsGetGeneratorOfPublicKey(&gen);
+#ifdef BLS_SWAP_G
+	mclBnG1_mul(&pub->v, &gen.v, &sec->v);
+#else
+	mclBnG2_mul(&pub->v, &gen.v, &sec->v);
+#endif
+}
+
+void blsGetPublicKeyVecTest()
+{
+	const size_t n = 100;
+	blsSecretKey secVec[n];
+	blsPublicKey pubVec[n], pubVec2[n];
+	for (size_t i = 0; i < n; i++) {
+		blsSecretKeySetByCSPRNG(&secVec[i]);
+	}
+	// 0, 1, -1, 2 and -2 (an even scalar is negated)
+	const unsigned char one = 1;
+	memset(&secVec[0], 0, sizeof(secVec[0]));
+	blsSecretKeySetLittleEndian(&secVec[1], &one, 1);
+	secVec[2] = secVec[0];
+	blsSecretKeySub(&secVec[2], &secVec[1]);
+	secVec[3] = secVec[1];
+	blsSecretKeyAdd(&secVec[3], &secVec[1]);
+	secVec[4] = secVec[2];
+	blsSecretKeyAdd(&secVec[4], &secVec[2]);
+	for (size_t i = 0; i < n; i++) {
+		blsGetPublicKey(&pubVec[i], &secVec[i]);
+		mulGeneratorOfPublicKey(&pubVec2[i], &secVec[i]);
+		CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pubVec[i], &pubVec2[i]));
+	}
+	for (size_t t = 0; t < CYBOZU_NUM_OF_ARRAY(threadTbl); t++) {
+		memset(pubVec2, 0, sizeof(pubVec2));
+		blsGetPublicKeyVec(pubVec2, secVec, n, threadTbl[t]);
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_ASSERT(blsPublicKeyIsEqual(&pubVec[i], &pubVec2[i]));
+		}
+	}
+	CYBOZU_BENCH_C("getPublicKey", 100, blsGetPublicKey, &pubVec[5], &secVec[5]);
+	CYBOZU_BENCH_C("mulGenerator", 100, mulGeneratorOfPublicKey, &pubVec[5], &secVec[5]);
+	CYBOZU_BENCH_C("getPublicKeyVec", 10, blsGetPublicKeyVec, pubVec2, secVec, n, 1);
+	CYBOZU_BENCH_C("getPublicKeyVecMT", 10, blsGetPublicKeyVec, pubVec2, secVec, n, 0);
+}
+
 CYBOZU_TEST_AUTO(all)
 {
 	const struct {
@@ -431,5 +1569,28 @@ CYBOZU_TEST_AUTO(all)
 		blsTrivialShareTest();
 		modTest(tbl[i].r);
 		blsBench();
+		blsSignVecTest();
+		blsSignSameMessageTest();
+		blsBatchVerifyTest();
+#ifndef BLS_SWAP_G
+		blsPublicKeyPrecomputedTest();
+#endif
+		blsMessageTest();
+		blsHashCacheTest();
+		blsPublicKeyRegistryTest();
+		blsPublicKeyAggregatorTest();
+		blsDeserializeVecTest();
+		blsNormalizeVecTest();
+		blsSerializeVecTest();
+		blsMultiAggregateMTTest();
+		blsSha256Test();
+		blsAggVerifyTest();
+		blsPtrVerifyTest();
+		blsAggregateVerifyGroupByMessageTest();
+		blsRecoveryPlanTest();
+		blsLargeRecoverTest();
+		blsShareVecTest();
+		blsGetPublicKeyVecTest();
+		blsStatsTest();
 	}
 }
@@ -1,4 +1,8 @@
 #include <bls/bls.hpp>
+#if !defined(BLS_DONT_USE_THREAD) && !defined(MCL_DONT_USE_CSPRNG)
+	#define BLS_TEST_VERIFY_SERVICE
+	#include <bls/verify_service.hpp>
+#endif
 #include <cybozu/test.hpp>
 #include <cybozu/inttype.hpp>
 #include <cybozu/benchmark.hpp>
@@ -215,6 +219,7 @@ void k_of_nTest()
 		idVec[2] = allIdVec[0];
 		bls::SecretKey sec;
 		CYBOZU_TEST_EXCEPTION_MESSAGE(sec.recover(secVec, idVec), std::exception, "same id");
+		CYBOZU_TEST_EXCEPTION_MESSAGE(bls::RecoveryPlan plan(idVec), std::exception, "same id");
 	}
 	{
 		/*
@@ -269,6 +274,11 @@ void k_of_nTest()
 		sigVec[2] = allSigVec[3]; idVec[2] = allIdVec[3];
 		bls::Signature sig;
 		CYBOZU_BENCH_C("sig.recover", 100, sig.recover, sigVec, idVec);
+		const bls::RecoveryPlan plan(idVec);
+		bls::Signature sig2;
+		sig2.recover(sigVec, plan);
+		CYBOZU_TEST_EQUAL(sig2, sig);
+		CYBOZU_BENCH_C("sig.recoverByPlan", 100, sig.recover, sigVec, plan);
 	}
 	{
 		/*
@@ -522,8 +532,12 @@ void testAggregatedHashes(size_t n)
 	h[0].data[0]++;
 	CYBOZU_TEST_ASSERT(!sig.verifyAggregatedHashes(pubs.data(), h.data(), sizeofHash, n));
 #endif
+	for (size_t threadN = 0; threadN <= 4; threadN++) {
+		CYBOZU_TEST_EQUAL(blsVerifyAggregatedHashesMT(sig.getPtr(), pubs[0].getPtr(), h.data(), sizeofHash, n, threadN), sig.verifyAggregatedHashes(pubs.data(), h.data(), sizeofHash, n));
+	}
 	printf("n=%2d ", (int)n);
 	CYBOZU_BENCH_C("aggregate", 50, sig.verifyAggregatedHashes, pubs.data(), h.data(), sizeofHash, n);
+	CYBOZU_BENCH_C("aggregateMT", 50, blsVerifyAggregatedHashesMT, sig.getPtr(), pubs[0].getPtr(), h.data(), sizeofHash, n, 0);
 }
 
 void verifyAggregateTest(int type)
@@ -538,6 +552,118 @@ void verifyAggregateTest(int type)
 	}
 }
 
+#ifdef BLS_TEST_VERIFY_SERVICE
+void countResult(void *arg, int result)
+{
+	std::atomic<int> *cnt = (std::atomic<int>*)arg;
+	cnt[result]++;
+}
+
+struct SubmitJobs {
+	bls::VerifyService& vs;
+	const std::vector<bls::PublicKey>& pubs;
+	const std::vector<bls::Signature>& sigs;
+	const std::vector<std::string>& msgs;
+	std::vector<bls::VerifyService::Result>& rets;
+	std::atomic<int> *cnt;
+	SubmitJobs(bls::VerifyService& vs, const std::vector<bls::PublicKey>& pubs, const std::vector<bls::Signature>& sigs, const std::vector<std::string>& msgs, std::vector<bls::VerifyService::Result>& rets, std::atomic<int> *cnt)
+		: vs(vs), pubs(pubs), sigs(sigs), msgs(msgs), rets(rets), cnt(cnt)
+	{
+	}
+	void operator()(size_t begin, size_t end) const
+	{
+		for (size_t i = begin; i < end; i++) {
+			rets[i] = vs.submit(sigs[i], pubs[i], msgs[i].data(), msgs[i].size(), countResult, cnt);
+		}
+	}
+};
+
+void verifyServiceTest(int type)
+{
+	const size_t n = 50;
+	std::vector<bls::PublicKey> pubs(n);
+	std::vector<bls::Signature> sigs(n);
+	std::vector<std::string> msgs(n);
+	int invalidN = 0;
+	for (size_t i = 0; i < n; i++) {
+		bls::SecretKey sec;
+		sec.init();
+		sec.getPublicKey(pubs[i]);
+		msgs[i] = "msg";
+		msgs[i] += char('0' + (i % 8));
+		sec.sign(sigs[i], msgs[i]);
+		if (i % 7 == 3) {
+			msgs[i] += 'x';
+			invalidN++;
+		}
+	}
+	std::vector<bls::VerifyService::Result> rets(n);
+	std::atomic<int> cnt[2];
+	cnt[0] = 0;
+	cnt[1] = 0;
+	{
+		bls::VerifyService vs(8, 500);
+		const size_t threadN = 4;
+		SubmitJobs f(vs, pubs, sigs, msgs, rets, cnt);
+		std::vector<std::thread> ts;
+		for (size_t t = 0; t < threadN; t++) {
+			ts.push_back(std::thread(f, n * t / threadN, n * (t + 1) / threadN));
+		}
+		for (size_t t = 0; t < threadN; t++) ts[t].join();
+		for (size_t i = 0; i < n; i++) {
+			CYBOZU_TEST_EQUAL(rets[i].wait(), i % 7 != 3);
+		}
+		// a submission after an idle time is cut by the latency
+		bls::VerifyService::Result r = vs.submit(sigs[0], pubs[0], msgs[0].data(), msgs[0].size());
+		CYBOZU_TEST_EQUAL(r.wait(), 1);
+		CYBOZU_TEST_EQUAL(vs.getPendingNum(), 0);
+	}
+	CYBOZU_TEST_EQUAL(cnt[0].load(), invalidN);
+	CYBOZU_TEST_EQUAL(cnt[1].load(), int(n) - invalidN);
+	// the remaining jobs are verified in the destructor
+	{
+		bls::VerifyService vs(1000, 1000 * 1000 * 100);
+		for (size_t i = 0; i < n; i++) {
+			rets[i] = vs.submit(sigs[i], pubs[i], msgs[i].data(), msgs[i].size());
+		}
+	}
+	for (size_t i = 0; i < n; i++) {
+		CYBOZU_TEST_ASSERT(rets[i].isReady());
+		CYBOZU_TEST_EQUAL(rets[i].get(), i % 7 != 3);
+	}
+#ifndef BLS_ETH
+	// a signature which does not have the valid order is 0 and does not affect the others
+	if (type == MCL_BLS12_381) {
+		uint8_t buf[96] = {};
+#ifdef BLS_SWAP_G
+		const size_t sigSize = 96;
+		buf[0] = 0x7b;
+#else
+		const size_t sigSize = 48;
+		buf[0] = 0x7c;
+#endif
+		buf[sigSize - 1] = 0x80;
+		blsSignature badSig;
+		blsSignatureVerifyOrder(0);
+		CYBOZU_TEST_ASSERT(blsSignatureDeserialize(&badSig, buf, sigSize) > 0);
+		blsSignatureVerifyOrder(1);
+		CYBOZU_TEST_ASSERT(!blsSignatureIsValidOrder(&badSig));
+		{
+			bls::VerifyService vs(1000, 1000 * 1000 * 100);
+			rets[0] = vs.submit(sigs[0], pubs[0], msgs[0].data(), msgs[0].size());
+			rets[1] = vs.submit(badSig, *pubs[1].getPtr(), msgs[1].data(), msgs[1].size());
+			rets[2] = vs.submit(sigs[2], pubs[2], msgs[2].data(), msgs[2].size());
+		}
+		CYBOZU_TEST_EQUAL(rets[0].get(), 1);
+		CYBOZU_TEST_EQUAL(rets[1].get(), 0);
+		CYBOZU_TEST_EQUAL(rets[2].get(), 1);
+	}
+#else
+	(void)type;
+#endif
+}
+#endif
+
 unsigned int writeSeq(void *self, void *buf, unsigned int bufSize)
 {
 	int& seq = *(int*)self;
@@ -746,9 +872,14 @@ void blsAggregateVerifyNoCheckTestOne(size_t n)
 	blsSignature aggSig;
 	blsAggregateSignature(&aggSig, sigs[0].getPtr(), n);
 	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheck(&aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n), 1);
+	for (size_t threadN = 0; threadN <= 4; threadN++) {
+		CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckMT(&aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n, threadN), 1);
+	}
 	CYBOZU_BENCH_C("blsAggregateVerifyNoCheck", 50, blsAggregateVerifyNoCheck, &aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n);
+	CYBOZU_BENCH_C("blsAggregateVerifyNoCheckMT", 50, blsAggregateVerifyNoCheckMT, &aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n, 0);
 	(*(char*)(&aggSig))++;
 	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheck(&aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n), 0);
+	CYBOZU_TEST_EQUAL(blsAggregateVerifyNoCheckMT(&aggSig, pubs[0].getPtr(), msgs.data(), msgSize, n, 0), 0);
 }
 
 void blsAggregateVerifyNoCheckTest()
@@ -834,6 +965,9 @@ void testAll(int type)
 	aggregateTest();
 	verifyAggregateTest(type);
 	setRandFuncTest(type);
+#ifdef BLS_TEST_VERIFY_SERVICE
+	verifyServiceTest(type);
+#endif
 	hashTest(type);
 #endif
 #ifdef BLS_ETH